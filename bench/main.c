@@ -23,13 +23,14 @@
 //
 // For more information, please refer to <http://unlicense.org/>
 
+// The small hashmap benchmarks need the inline elements built in, and the
+// integer key benchmarks need inline keys.
+#define HASHMAP_SMALL_SIZE 8
+#define HASHMAP_INLINE_KEY_SIZE 16
+
 #include "ubench.h"
 #include "hashmap.h"
 
-#if defined(HASHMAP_X86_SSE42)
-#error Cannot be compiled with SSE 4.2 support!
-#endif
-
 UBENCH(create, initial_size_1_kilobyte) {
   struct hashmap_s hashmap;
   hashmap_create(1024, &hashmap);
@@ -37,26 +38,70 @@ UBENCH(create, initial_size_1_kilobyte) {
   hashmap_destroy(&hashmap);
 }
 
+static void create_put_get_4_entries(hashmap_uint32_t flags) {
+  static const char keys[] = "abcd";
+  struct hashmap_s hashmap;
+  struct hashmap_create_options_s options;
+  int i;
+
+  memset(&options, 0, sizeof(options));
+  options.flags = flags;
+  hashmap_create_ex(options, &hashmap);
+
+  for (i = 0; i < 4; i++) {
+    hashmap_put(&hashmap, keys + i, 1, 0);
+  }
+
+  for (i = 0; i < 4; i++) {
+    UBENCH_DO_NOTHING(hashmap_get(&hashmap, keys + i, 1));
+  }
+
+  hashmap_destroy(&hashmap);
+}
+
+UBENCH(create, put_get_4_entries) { create_put_get_4_entries(0); }
+
+UBENCH(create, put_get_4_entries_small) {
+  create_put_get_4_entries(HASHMAP_FLAG_SMALL);
+}
+
 struct put_small_keys {
   char *keys;
   unsigned key_len;
+  const void **key_ptrs;
+  hashmap_size_t *lens;
+  void **values;
 };
 
 UBENCH_F_SETUP(put_small_keys) {
   const unsigned max_keys = 1024 * 1024;
   const unsigned key_len = 8;
-  char *const keys = malloc(max_keys * key_len);
+  char *const keys = malloc((max_keys * key_len) + 1);
+  const void **const key_ptrs = malloc(max_keys * sizeof(void *));
+  hashmap_size_t *const lens = malloc(max_keys * sizeof(hashmap_size_t));
+  void **const values = malloc(max_keys * sizeof(void *));
   unsigned i;
 
   for (i = 0; i < max_keys; i++) {
-    snprintf(keys + (i * key_len), key_len, "%08x", i);
+    snprintf(keys + (i * key_len), key_len + 1, "%08x", i);
+    key_ptrs[i] = keys + (i * key_len);
+    lens[i] = key_len;
+    values[i] = 0;
   }
 
   ubench_fixture->keys = keys;
   ubench_fixture->key_len = key_len;
+  ubench_fixture->key_ptrs = key_ptrs;
+  ubench_fixture->lens = lens;
+  ubench_fixture->values = values;
 }
 
-UBENCH_F_TEARDOWN(put_small_keys) { free(ubench_fixture->keys); }
+UBENCH_F_TEARDOWN(put_small_keys) {
+  free(ubench_fixture->keys);
+  free(ubench_fixture->key_ptrs);
+  free(ubench_fixture->lens);
+  free(ubench_fixture->values);
+}
 
 UBENCH_F(put_small_keys, 1024) {
   struct hashmap_s hashmap;
@@ -90,6 +135,141 @@ UBENCH_F(put_small_keys, 1048576) {
   hashmap_destroy(&hashmap);
 }
 
+UBENCH_F(put_small_keys, 1048576_batch) {
+  struct hashmap_s hashmap;
+
+  hashmap_create(1, &hashmap);
+  hashmap_put_batch(&hashmap, ubench_fixture->key_ptrs, ubench_fixture->lens,
+                    ubench_fixture->values, 1048576, 0);
+
+  UBENCH_DO_NOTHING(&hashmap);
+  hashmap_destroy(&hashmap);
+}
+
+UBENCH_F(put_small_keys, 1048576_reserved) {
+  struct hashmap_s hashmap;
+  int i;
+
+  hashmap_create(1, &hashmap);
+  hashmap_reserve(&hashmap, 1048576);
+
+  for (i = 0; i < 1048576; i++) {
+    const unsigned offset = i * ubench_fixture->key_len;
+    hashmap_put(&hashmap, ubench_fixture->keys + offset,
+                ubench_fixture->key_len, 0);
+  }
+
+  UBENCH_DO_NOTHING(&hashmap);
+  hashmap_destroy(&hashmap);
+}
+
+UBENCH_F(put_small_keys, count_get_then_put) {
+  struct hashmap_s hashmap;
+  int i;
+
+  hashmap_create(1, &hashmap);
+
+  for (i = 0; i < 1048576; i++) {
+    const unsigned offset = (i % 65536) * ubench_fixture->key_len;
+    char *const count = (char *)hashmap_get(
+        &hashmap, ubench_fixture->keys + offset, ubench_fixture->key_len);
+    hashmap_put(&hashmap, ubench_fixture->keys + offset,
+                ubench_fixture->key_len, count + 1);
+  }
+
+  UBENCH_DO_NOTHING(&hashmap);
+  hashmap_destroy(&hashmap);
+}
+
+UBENCH_F(put_small_keys, count_get_or_insert) {
+  struct hashmap_s hashmap;
+  int i;
+
+  hashmap_create(1, &hashmap);
+
+  for (i = 0; i < 1048576; i++) {
+    const unsigned offset = (i % 65536) * ubench_fixture->key_len;
+    void **const count = hashmap_get_or_insert(
+        &hashmap, ubench_fixture->keys + offset, ubench_fixture->key_len, 0);
+    *count = (char *)*count + 1;
+  }
+
+  UBENCH_DO_NOTHING(&hashmap);
+  hashmap_destroy(&hashmap);
+}
+
+struct put_small_keys_latency {
+  char *keys;
+  unsigned key_len;
+  ubench_int64_t *ns;
+};
+
+UBENCH_F_SETUP(put_small_keys_latency) {
+  const unsigned max_keys = 1024 * 1024;
+  const unsigned key_len = 8;
+  char *const keys = malloc((max_keys * key_len) + 1);
+  unsigned i;
+
+  for (i = 0; i < max_keys; i++) {
+    snprintf(keys + (i * key_len), key_len + 1, "%08x", i);
+  }
+
+  ubench_fixture->keys = keys;
+  ubench_fixture->key_len = key_len;
+  ubench_fixture->ns = malloc(max_keys * sizeof(ubench_int64_t));
+}
+
+static int compare_ns(const void *a, const void *b) {
+  const ubench_int64_t x = *(const ubench_int64_t *)a;
+  const ubench_int64_t y = *(const ubench_int64_t *)b;
+  return (x > y) - (x < y);
+}
+
+UBENCH_F_TEARDOWN(put_small_keys_latency) {
+  const unsigned max_keys = 1024 * 1024;
+  ubench_int64_t *const ns = ubench_fixture->ns;
+
+  /* Report the spread of the individual puts from the last run, as the mean
+   * hides the puts that had to grow the hashmap. */
+  qsort(ns, max_keys, sizeof(ubench_int64_t), compare_ns);
+  printf("             put p50 %" UBENCH_PRId64 "ns, p99 %" UBENCH_PRId64
+         "ns, p99.9 %" UBENCH_PRId64 "ns, max %" UBENCH_PRId64 "ns\n",
+         ns[max_keys / 2], ns[max_keys - (max_keys / 100)],
+         ns[max_keys - (max_keys / 1000)], ns[max_keys - 1]);
+
+  free(ns);
+  free(ubench_fixture->keys);
+}
+
+static void put_small_keys_latency(struct put_small_keys_latency *fixture,
+                                   hashmap_uint32_t flags) {
+  struct hashmap_s hashmap;
+  struct hashmap_create_options_s options;
+  int i;
+
+  memset(&options, 0, sizeof(options));
+  options.flags = flags;
+  hashmap_create_ex(options, &hashmap);
+
+  for (i = 0; i < 1048576; i++) {
+    const unsigned offset = i * fixture->key_len;
+    const ubench_int64_t start = ubench_ns();
+    hashmap_put(&hashmap, fixture->keys + offset, fixture->key_len, 0);
+    fixture->ns[i] = ubench_ns() - start;
+  }
+
+  UBENCH_DO_NOTHING(&hashmap);
+  hashmap_destroy(&hashmap);
+}
+
+UBENCH_F(put_small_keys_latency, rehash) {
+  put_small_keys_latency(ubench_fixture, 0);
+}
+
+UBENCH_F(put_small_keys_latency, incremental) {
+  put_small_keys_latency(ubench_fixture, HASHMAP_FLAG_INCREMENTAL);
+}
+
 struct put_large_keys {
   char *keys;
   unsigned key_len;
@@ -98,11 +278,11 @@ struct put_large_keys {
 UBENCH_F_SETUP(put_large_keys) {
   const unsigned max_keys = 1024 * 1024;
   const unsigned key_len = 1024;
-  char *const keys = malloc(max_keys * key_len);
+  char *const keys = malloc((max_keys * key_len) + 1);
   unsigned i;
 
   for (i = 0; i < max_keys; i++) {
-    snprintf(keys + (i * key_len), key_len, "%01024x", i);
+    snprintf(keys + (i * key_len), key_len + 1, "%01024x", i);
   }
 
   ubench_fixture->keys = keys;
@@ -136,12 +316,12 @@ struct get_small_keys {
 UBENCH_F_SETUP(get_small_keys) {
   const unsigned max_keys = 1024 * 1024;
   const unsigned key_len = 8;
-  char *const keys = malloc(max_keys * key_len);
+  char *const keys = malloc((max_keys * key_len) + 1);
   unsigned i;
   struct hashmap_s hashmap;
 
   for (i = 0; i < max_keys; i++) {
-    snprintf(keys + (i * key_len), key_len, "%08x", i);
+    snprintf(keys + (i * key_len), key_len + 1, "%08x", i);
   }
   hashmap_create(1, &hashmap);
 
@@ -164,6 +344,20 @@ UBENCH_F(get_small_keys, small_missing_key) {
   UBENCH_DO_NOTHING(hashmap_get(&ubench_fixture->hashmap, "a", strlen("a")));
 }
 
+UBENCH_F(get_small_keys, present_keys) {
+  const unsigned max_keys = 1024 * 1024;
+  char key[9];
+  unsigned i;
+
+  /* Look up copies of keys from all over the hashmap, so that the stored keys
+   * are not already in the cache from building the key we look up with. */
+  for (i = 0; i < 1024; i++) {
+    snprintf(key, sizeof(key), "%08x", (i * 7919u) % max_keys);
+    UBENCH_DO_NOTHING(
+        hashmap_get(&ubench_fixture->hashmap, key, ubench_fixture->key_len));
+  }
+}
+
 UBENCH_F(get_small_keys, large_missing_key) {
 #define DATA_SIZE (16 * 1024)
   char data[DATA_SIZE];
@@ -187,12 +381,12 @@ struct get_large_keys {
 UBENCH_F_SETUP(get_large_keys) {
   const unsigned max_keys = 1024 * 1024;
   const unsigned key_len = 1024;
-  char *const keys = malloc(max_keys * key_len);
+  char *const keys = malloc((max_keys * key_len) + 1);
   unsigned i;
   struct hashmap_s hashmap;
 
   for (i = 0; i < max_keys; i++) {
-    snprintf(keys + (i * key_len), key_len, "%01024x", i);
+    snprintf(keys + (i * key_len), key_len + 1, "%01024x", i);
   }
   hashmap_create(1, &hashmap);
 
@@ -230,3 +424,375 @@ UBENCH_F(get_large_keys, large_missing_key) {
 }
 
 UBENCH_MAIN()
+
+struct integer_keys {
+  hashmap_uint64_t *ids;
+  struct hashmap_s u64_hashmap;
+  struct hashmap_s pointer_hashmap;
+};
+
+UBENCH_F_SETUP(integer_keys) {
+  const unsigned max_keys = 1024 * 1024;
+  hashmap_uint64_t *const ids = malloc(max_keys * sizeof(hashmap_uint64_t));
+  unsigned i;
+
+  for (i = 0; i < max_keys; i++) {
+    ids[i] = (hashmap_uint64_t)i * 2654435761u;
+  }
+
+  hashmap_create(1, &ubench_fixture->u64_hashmap);
+  hashmap_create(1, &ubench_fixture->pointer_hashmap);
+
+  for (i = 0; i < max_keys; i++) {
+    hashmap_put_u64(&ubench_fixture->u64_hashmap, ids[i], 0);
+    hashmap_put(&ubench_fixture->pointer_hashmap, &ids[i], sizeof(ids[i]), 0);
+  }
+
+  ubench_fixture->ids = ids;
+}
+
+UBENCH_F_TEARDOWN(integer_keys) {
+  hashmap_destroy(&ubench_fixture->u64_hashmap);
+  hashmap_destroy(&ubench_fixture->pointer_hashmap);
+  free(ubench_fixture->ids);
+}
+
+UBENCH_F(integer_keys, put_u64_1048576) {
+  struct hashmap_s hashmap;
+  unsigned i;
+
+  hashmap_create(1, &hashmap);
+
+  for (i = 0; i < 1048576; i++) {
+    hashmap_put_u64(&hashmap, ubench_fixture->ids[i], 0);
+  }
+
+  UBENCH_DO_NOTHING(&hashmap);
+  hashmap_destroy(&hashmap);
+}
+
+UBENCH_F(integer_keys, put_pointer_1048576) {
+  struct hashmap_s hashmap;
+  unsigned i;
+
+  hashmap_create(1, &hashmap);
+
+  for (i = 0; i < 1048576; i++) {
+    hashmap_put(&hashmap, &ubench_fixture->ids[i],
+                sizeof(ubench_fixture->ids[i]), 0);
+  }
+
+  UBENCH_DO_NOTHING(&hashmap);
+  hashmap_destroy(&hashmap);
+}
+
+UBENCH_F(integer_keys, get_u64) {
+  unsigned i;
+
+  for (i = 0; i < 1024; i++) {
+    const hashmap_uint64_t id = ubench_fixture->ids[(i * 7919u) % 1048576];
+    UBENCH_DO_NOTHING(hashmap_get_u64(&ubench_fixture->u64_hashmap, id));
+  }
+}
+
+UBENCH_F(integer_keys, get_pointer) {
+  unsigned i;
+
+  /* Look up with a copy of the key, as a caller with an integer would. */
+  for (i = 0; i < 1024; i++) {
+    const hashmap_uint64_t id = ubench_fixture->ids[(i * 7919u) % 1048576];
+    UBENCH_DO_NOTHING(
+        hashmap_get(&ubench_fixture->pointer_hashmap, &id, sizeof(id)));
+  }
+}
+
+struct large_table {
+  hashmap_uint64_t *ids;
+  struct hashmap_s hashmap;
+  struct hashmap_s huge_page_hashmap;
+};
+
+#define LARGE_TABLE_KEYS (2 * 1024 * 1024)
+
+UBENCH_F_SETUP(large_table) {
+  hashmap_uint64_t *const ids =
+      malloc(LARGE_TABLE_KEYS * sizeof(hashmap_uint64_t));
+  struct hashmap_create_options_s options;
+  unsigned i;
+
+  for (i = 0; i < LARGE_TABLE_KEYS; i++) {
+    ids[i] = (hashmap_uint64_t)i * 2654435761u;
+  }
+
+  memset(&options, 0, sizeof(options));
+  hashmap_create_ex(options, &ubench_fixture->hashmap);
+  options.flags = HASHMAP_FLAG_HUGE_PAGES | HASHMAP_FLAG_PREFAULT;
+  hashmap_create_ex(options, &ubench_fixture->huge_page_hashmap);
+
+  for (i = 0; i < LARGE_TABLE_KEYS; i++) {
+    hashmap_put_u64(&ubench_fixture->hashmap, ids[i], 0);
+    hashmap_put_u64(&ubench_fixture->huge_page_hashmap, ids[i], 0);
+  }
+
+  ubench_fixture->ids = ids;
+}
+
+UBENCH_F_TEARDOWN(large_table) {
+  hashmap_destroy(&ubench_fixture->hashmap);
+  hashmap_destroy(&ubench_fixture->huge_page_hashmap);
+  free(ubench_fixture->ids);
+}
+
+static void large_table_get(const struct hashmap_s *const hashmap,
+                            const hashmap_uint64_t *const ids) {
+  unsigned i;
+
+  /* Stride through the keys so that nearly every lookup lands on a page the
+   * last one did not. */
+  for (i = 0; i < 4096; i++) {
+    UBENCH_DO_NOTHING(
+        hashmap_get_u64(hashmap, ids[(i * 7919u) % LARGE_TABLE_KEYS]));
+  }
+}
+
+UBENCH_F(large_table, get) {
+  large_table_get(&ubench_fixture->hashmap, ubench_fixture->ids);
+}
+
+UBENCH_F(large_table, get_huge_pages) {
+  large_table_get(&ubench_fixture->huge_page_hashmap, ubench_fixture->ids);
+}
+
+static void large_table_put_reserved(const hashmap_uint64_t *const ids,
+                                     const hashmap_uint32_t flags) {
+  struct hashmap_s hashmap;
+  struct hashmap_create_options_s options;
+  unsigned i;
+
+  memset(&options, 0, sizeof(options));
+  options.flags = flags;
+  options.expected_entries = LARGE_TABLE_KEYS;
+  hashmap_create_ex(options, &hashmap);
+
+  for (i = 0; i < LARGE_TABLE_KEYS; i++) {
+    hashmap_put_u64(&hashmap, ids[i], 0);
+  }
+
+  UBENCH_DO_NOTHING(&hashmap);
+  hashmap_destroy(&hashmap);
+}
+
+UBENCH_F(large_table, put_reserved) {
+  large_table_put_reserved(ubench_fixture->ids, 0);
+}
+
+UBENCH_F(large_table, put_reserved_huge_pages) {
+  large_table_put_reserved(ubench_fixture->ids,
+                           HASHMAP_FLAG_HUGE_PAGES | HASHMAP_FLAG_PREFAULT);
+}
+
+struct batch_get {
+  hashmap_uint64_t *ids;
+  const void **keys;
+  hashmap_size_t *lens;
+  void **values;
+  struct hashmap_s hashmap;
+};
+
+#define BATCH_GET_LOOKUPS 4096
+
+UBENCH_F_SETUP(batch_get) {
+  hashmap_uint64_t *const ids =
+      malloc(LARGE_TABLE_KEYS * sizeof(hashmap_uint64_t));
+  unsigned i;
+
+  for (i = 0; i < LARGE_TABLE_KEYS; i++) {
+    ids[i] = (hashmap_uint64_t)i * 2654435761u;
+  }
+
+  hashmap_create(1, &ubench_fixture->hashmap);
+
+  for (i = 0; i < LARGE_TABLE_KEYS; i++) {
+    hashmap_put(&ubench_fixture->hashmap, &ids[i], sizeof(ids[i]), 0);
+  }
+
+  /* The same strided lookups as large_table, far bigger than the LLC. */
+  ubench_fixture->keys = malloc(BATCH_GET_LOOKUPS * sizeof(const void *));
+  ubench_fixture->lens = malloc(BATCH_GET_LOOKUPS * sizeof(hashmap_size_t));
+  ubench_fixture->values = malloc(BATCH_GET_LOOKUPS * sizeof(void *));
+
+  for (i = 0; i < BATCH_GET_LOOKUPS; i++) {
+    ubench_fixture->keys[i] = &ids[(i * 7919u) % LARGE_TABLE_KEYS];
+    ubench_fixture->lens[i] = sizeof(hashmap_uint64_t);
+  }
+
+  ubench_fixture->ids = ids;
+}
+
+UBENCH_F_TEARDOWN(batch_get) {
+  hashmap_destroy(&ubench_fixture->hashmap);
+  free(ubench_fixture->values);
+  free(ubench_fixture->lens);
+  free(ubench_fixture->keys);
+  free(ubench_fixture->ids);
+}
+
+UBENCH_F(batch_get, get_loop) {
+  unsigned i;
+
+  for (i = 0; i < BATCH_GET_LOOKUPS; i++) {
+    ubench_fixture->values[i] =
+        hashmap_get(&ubench_fixture->hashmap, ubench_fixture->keys[i],
+                    ubench_fixture->lens[i]);
+  }
+
+  UBENCH_DO_NOTHING(ubench_fixture->values);
+}
+
+UBENCH_F(batch_get, get_batch_64) {
+  unsigned i;
+
+  for (i = 0; i < BATCH_GET_LOOKUPS; i += 64) {
+    hashmap_get_batch(&ubench_fixture->hashmap, &ubench_fixture->keys[i],
+                      &ubench_fixture->lens[i], 64,
+                      &ubench_fixture->values[i]);
+  }
+
+  UBENCH_DO_NOTHING(ubench_fixture->values);
+}
+
+/* The crc32 hasher picks which of these to use when it first runs, so they
+ * are benchmarked directly to see every one the CPU can run. */
+struct crc32_backends {
+  hashmap_uint8_t *data;
+};
+
+#define CRC32_BACKENDS_DATA (16 * 1024)
+
+UBENCH_F_SETUP(crc32_backends) {
+  hashmap_uint8_t *const data = malloc(CRC32_BACKENDS_DATA);
+  unsigned i;
+
+  for (i = 0; i < CRC32_BACKENDS_DATA; i++) {
+    data[i] = (hashmap_uint8_t)(i * 2654435761u >> 24);
+  }
+
+  ubench_fixture->data = data;
+}
+
+UBENCH_F_TEARDOWN(crc32_backends) { free(ubench_fixture->data); }
+
+static void crc32_table(const hashmap_uint8_t *const data,
+                        const hashmap_size_t len) {
+  hashmap_uint32_t crc = 0;
+  hashmap_size_t i;
+
+  for (i = 0; i + len <= CRC32_BACKENDS_DATA; i += len) {
+    crc ^= hashmap_crc32_table_helper(~0u, data + i, len);
+  }
+
+  UBENCH_DO_NOTHING(&crc);
+}
+
+UBENCH_F(crc32_backends, table_16) { crc32_table(ubench_fixture->data, 16); }
+
+UBENCH_F(crc32_backends, table_256) {
+  crc32_table(ubench_fixture->data, 256);
+}
+
+UBENCH_F(crc32_backends, table_16384) {
+  crc32_table(ubench_fixture->data, 16384);
+}
+
+#if defined(HASHMAP_CRC32_STREAMS)
+static void crc32_instructions(const hashmap_uint8_t *const data,
+                               const hashmap_size_t len) {
+  hashmap_uint32_t crc = 0;
+  hashmap_size_t i;
+
+#if defined(HASHMAP_CRC32_DISPATCH)
+  if (!hashmap_crc32_supported_helper()) {
+    return;
+  }
+#endif
+
+  for (i = 0; i + len <= CRC32_BACKENDS_DATA; i += len) {
+    crc ^= hashmap_crc32_instructions_helper(~0u, data + i, len);
+  }
+
+  UBENCH_DO_NOTHING(&crc);
+}
+
+UBENCH_F(crc32_backends, instructions_16) {
+  crc32_instructions(ubench_fixture->data, 16);
+}
+
+UBENCH_F(crc32_backends, instructions_256) {
+  crc32_instructions(ubench_fixture->data, 256);
+}
+
+UBENCH_F(crc32_backends, instructions_16384) {
+  crc32_instructions(ubench_fixture->data, 16384);
+}
+#endif
+
+/* Every benchmark hashes the same 16 kilobytes, cut into keys of the length in
+ * its name, so their times can be compared at a glance. */
+struct hashers {
+  hashmap_uint8_t *data;
+};
+
+#define HASHERS_DATA (16 * 1024)
+
+UBENCH_F_SETUP(hashers) {
+  hashmap_uint8_t *const data = malloc(HASHERS_DATA);
+  unsigned i;
+
+  for (i = 0; i < HASHERS_DATA; i++) {
+    data[i] = (hashmap_uint8_t)(i * 2654435761u >> 24);
+  }
+
+  ubench_fixture->data = data;
+}
+
+UBENCH_F_TEARDOWN(hashers) { free(ubench_fixture->data); }
+
+static void hash_keys(const hashmap_hasher_t hasher,
+                      const hashmap_uint8_t *const data,
+                      const hashmap_size_t len) {
+  hashmap_hash_t hash = 0;
+  hashmap_size_t i;
+
+  for (i = 0; i + len <= HASHERS_DATA; i += len) {
+    hash ^= hasher(~0u, data + i, len);
+  }
+
+  UBENCH_DO_NOTHING(&hash);
+}
+
+#define HASHERS_BENCH(hasher, len)                                             \
+  UBENCH_F(hashers, hasher##_##len) {                                          \
+    hash_keys(&hashmap_##hasher##_hasher, ubench_fixture->data, len);          \
+  }
+
+HASHERS_BENCH(crc32, 4)
+HASHERS_BENCH(crc32, 16)
+HASHERS_BENCH(crc32, 64)
+HASHERS_BENCH(crc32, 256)
+HASHERS_BENCH(crc32, 1024)
+HASHERS_BENCH(crc32, 4096)
+HASHERS_BENCH(crc32, 16384)
+HASHERS_BENCH(mum, 4)
+HASHERS_BENCH(mum, 16)
+HASHERS_BENCH(mum, 64)
+HASHERS_BENCH(mum, 256)
+HASHERS_BENCH(mum, 1024)
+HASHERS_BENCH(mum, 4096)
+HASHERS_BENCH(mum, 16384)
+HASHERS_BENCH(stripes, 4)
+HASHERS_BENCH(stripes, 16)
+HASHERS_BENCH(stripes, 64)
+HASHERS_BENCH(stripes, 256)
+HASHERS_BENCH(stripes, 1024)
+HASHERS_BENCH(stripes, 4096)
+HASHERS_BENCH(stripes, 16384)
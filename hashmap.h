@@ -51,6 +51,20 @@
 #include <nmmintrin.h>
 #endif
 
+#if defined(HASHMAP_X86_SSE42) && (defined(__x86_64__) || defined(_M_X64))
+#define HASHMAP_X86_CRC32_U64
+#endif
+
+#if defined(HASHMAP_X86_CRC32_U64) &&                                          \
+    ((defined(_MSC_VER) && defined(__AVX__)) ||                                \
+     (!defined(_MSC_VER) && defined(__PCLMUL__)))
+#define HASHMAP_X86_PCLMUL
+#endif
+
+#if defined(HASHMAP_X86_PCLMUL)
+#include <wmmintrin.h>
+#endif
+
 #if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
 #define HASHMAP_ARM_CRC32
 #endif
@@ -59,10 +73,106 @@
 #include <arm_acle.h>
 #endif
 
+#if defined(HASHMAP_X86_CRC32_U64) || defined(HASHMAP_ARM_CRC32)
+#define HASHMAP_CRC32_STREAMS
+#endif
+
+/* When the crc instructions are not enabled at compile time, we compile a
+ * version of the crc32 hasher that uses them anyway and ask the CPU whether it
+ * has them the first time we hash something. */
+#if !defined(HASHMAP_X86_SSE42) && !defined(HASHMAP_ARM_CRC32) &&              \
+    !defined(HASHMAP_NO_CRC32_DISPATCH)
+#if defined(__x86_64__) && (defined(__clang__) || defined(__GNUC__)) &&        \
+    !defined(_MSC_VER) && !defined(__TINYC__)
+#define HASHMAP_X86_CRC32_DISPATCH
+#define HASHMAP_CRC32_TARGET __attribute__((target("sse4.2,pclmul")))
+#elif defined(_M_X64) && defined(_MSC_VER) && !defined(__clang__)
+#define HASHMAP_X86_CRC32_DISPATCH
+#include <intrin.h>
+#elif defined(__aarch64__) && defined(__linux__) && defined(__clang__) &&      \
+    (__clang_major__ >= 17)
+#define HASHMAP_ARM_CRC32_DISPATCH
+#define HASHMAP_CRC32_TARGET __attribute__((target("crc")))
+#elif defined(__aarch64__) && defined(__linux__) && !defined(__clang__) &&     \
+    defined(__GNUC__) && (__GNUC__ >= 10)
+#define HASHMAP_ARM_CRC32_DISPATCH
+#define HASHMAP_CRC32_TARGET __attribute__((target("+crc")))
+#endif
+#endif
+
+#if defined(HASHMAP_X86_CRC32_DISPATCH)
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#define HASHMAP_X86_CRC32_U64
+#define HASHMAP_X86_PCLMUL
+#endif
+
+#if defined(HASHMAP_ARM_CRC32_DISPATCH)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+
+#if defined(HWCAP_CRC32)
+#define HASHMAP_HWCAP_CRC32 HWCAP_CRC32
+#else
+#define HASHMAP_HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+
+#if defined(HASHMAP_X86_CRC32_DISPATCH) || defined(HASHMAP_ARM_CRC32_DISPATCH)
+#define HASHMAP_CRC32_DISPATCH
+#define HASHMAP_CRC32_STREAMS
+/* A function using instructions the caller was not compiled for cannot be
+ * inlined into it. */
+#define HASHMAP_CRC32_INLINE HASHMAP_WEAK HASHMAP_CRC32_TARGET
+#else
+#define HASHMAP_CRC32_INLINE HASHMAP_ALWAYS_INLINE
+#endif
+
+#if !defined(HASHMAP_CRC32_TARGET)
+#define HASHMAP_CRC32_TARGET
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define HASHMAP_X86_SSE2
+#endif
+
+#if defined(HASHMAP_X86_SSE2)
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define HASHMAP_X86_AVX2
+#endif
+
+#if defined(HASHMAP_X86_AVX2)
+#include <immintrin.h>
+#endif
+
+#if (defined(__aarch64__) && defined(__ARM_NEON)) || defined(_M_ARM64)
+#define HASHMAP_ARM_NEON
+#endif
+
+#if defined(HASHMAP_ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #if defined(_MSC_VER)
 #include <intrin.h>
 #endif
 
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+
+#if defined(MAP_ANONYMOUS)
+#define HASHMAP_MMAP
+#define HASHMAP_MAP_ANONYMOUS MAP_ANONYMOUS
+#elif defined(MAP_ANON)
+#define HASHMAP_MMAP
+#define HASHMAP_MAP_ANONYMOUS MAP_ANON
+#endif
+
 #if defined(_MSC_VER)
 #pragma warning(pop)
 #endif
@@ -93,6 +203,15 @@
 #define HASHMAP_ATTRIBUTE(a) __attribute__((a))
 #endif
 
+#if (defined(__clang__) || defined(__GNUC__)) && !defined(__TINYC__)
+#define HASHMAP_PREFETCH(p) __builtin_prefetch(p)
+#elif defined(_MSC_VER) && defined(HASHMAP_X86_SSE2)
+#define HASHMAP_PREFETCH(p)                                                    \
+  _mm_prefetch(HASHMAP_PTR_CAST(const char *, p), _MM_HINT_T0)
+#else
+#define HASHMAP_PREFETCH(p) ((void)(p))
+#endif
+
 #if defined(_MSC_VER)
 #define HASHMAP_WEAK __inline
 #elif defined(__MINGW32__) || defined(__MINGW64__)
@@ -125,34 +244,227 @@ typedef uint32_t hashmap_uint32_t;
 typedef uint64_t hashmap_uint64_t;
 #endif
 
+/* Define HASHMAP_64BIT to use 64-bit sizes, capacities, key lengths and
+ * hashes, for hashmaps with more than 2^31 slots or keys of 4GiB or more.
+ * Like HASHMAP_INLINE_KEY_SIZE it changes the layout of the hashmap, so it
+ * must be the same in every file that includes this header. The default hasher
+ * is then a 64-bit mix rather than the crc32 hasher, which is not built at
+ * all, so neither are its crc instruction paths or the check for them. */
+#if defined(HASHMAP_64BIT) && !defined(_WIN64) &&                              \
+    !(defined(__SIZEOF_POINTER__) && (8 == __SIZEOF_POINTER__))
+#error HASHMAP_64BIT needs a 64-bit target!
+#endif
+
+#if defined(HASHMAP_64BIT)
+typedef hashmap_uint64_t hashmap_size_t;
+typedef hashmap_uint64_t hashmap_hash_t;
+#else
+typedef hashmap_uint32_t hashmap_size_t;
+typedef hashmap_uint32_t hashmap_hash_t;
+#endif
+
+/* The largest hashmap_size_t, which is also used to mean none or all. */
+#define HASHMAP_SIZE_MAX (~HASHMAP_CAST(hashmap_size_t, 0))
+
+/* The capacity of a hashmap is a power of two that fits in hashmap_size_t. */
+#define HASHMAP_MAX_LOG2_CAPACITY ((sizeof(hashmap_size_t) * 8) - 1)
+
+/* Keys of up to this many bytes are also copied into the element itself, so
+ * that looking them up does not have to load the key from wherever it lives.
+ * This makes every element bigger, so it is 0 unless defined otherwise. Must
+ * be a multiple of 8, and the same in every file that includes this header. */
+#if !defined(HASHMAP_INLINE_KEY_SIZE)
+#define HASHMAP_INLINE_KEY_SIZE (0)
+#endif
+
+#if 0 != (HASHMAP_INLINE_KEY_SIZE % 8)
+#error HASHMAP_INLINE_KEY_SIZE must be a multiple of 8!
+#endif
+
 typedef struct hashmap_element_s {
   const void *key;
-  hashmap_uint32_t key_len;
+  hashmap_size_t key_len;
   int in_use;
+#if defined(HASHMAP_64BIT)
+  hashmap_uint32_t _;
+#endif
   void *data;
+  hashmap_hash_t hash;
+#if !defined(HASHMAP_64BIT)
+  hashmap_uint32_t _;
+#endif
+#if 0 < HASHMAP_INLINE_KEY_SIZE
+  hashmap_uint8_t inline_key[HASHMAP_INLINE_KEY_SIZE];
+#endif
 } hashmap_element_t;
 
-typedef hashmap_uint32_t (*hashmap_hasher_t)(hashmap_uint32_t seed,
-                                             const void *key,
-                                             hashmap_uint32_t key_len);
-typedef int (*hashmap_comparer_t)(const void *a, hashmap_uint32_t a_len,
-                                  const void *b, hashmap_uint32_t b_len);
+typedef hashmap_hash_t (*hashmap_hasher_t)(hashmap_hash_t seed, const void *key,
+                                           hashmap_size_t key_len);
+typedef int (*hashmap_comparer_t)(const void *a, hashmap_size_t a_len,
+                                  const void *b, hashmap_size_t b_len);
+
+/* How many entries a hashmap created with HASHMAP_FLAG_SMALL holds inline
+ * before it allocates a table. The inline elements are part of every hashmap,
+ * so they are only there if this is defined, as a power of two, and
+ * HASHMAP_FLAG_SMALL does nothing otherwise. Like HASHMAP_INLINE_KEY_SIZE it
+ * must be the same in every file that includes this header. */
+#if !defined(HASHMAP_SMALL_SIZE)
+#define HASHMAP_SMALL_SIZE (0)
+#endif
+
+#if 0 != (HASHMAP_SMALL_SIZE & (HASHMAP_SMALL_SIZE - 1))
+#error HASHMAP_SMALL_SIZE must be a power of two!
+#endif
+
+/* The allocator the hashmap uses for its table. The sizes passed to reallocate
+ * and deallocate are those the memory was allocated with, for allocators that
+ * do not track them. The memory does not need to be zeroed or aligned, as
+ * tables are allocated with a cache line to spare so that the hashmap can
+ * start them on a cache line itself. */
+typedef struct hashmap_allocator_s {
+  void *(*allocate)(void *context, size_t size);
+  void *(*reallocate)(void *context, void *pointer, size_t old_size,
+                      size_t new_size);
+  void (*deallocate)(void *context, void *pointer, size_t size);
+  void *context;
+} hashmap_allocator_t;
+
+/* A block of key memory, which the keys follow directly. */
+typedef struct hashmap_key_block_s {
+  struct hashmap_key_block_s *next;
+  size_t size;
+  size_t used;
+} hashmap_key_block_t;
 
 typedef struct hashmap_s {
   hashmap_uint32_t log2_capacity;
-  hashmap_uint32_t size;
+  hashmap_uint32_t old_log2_capacity;
+  hashmap_uint32_t flags;
+  hashmap_uint32_t probe_length;
+  hashmap_size_t size;
+  hashmap_size_t migrate_index;
+  hashmap_size_t shrink_limit;
+#if defined(HASHMAP_DEBUG)
+  /* Bumped by every change to the hashmap, to catch stale slots. */
+  hashmap_uint32_t generation;
+#if defined(HASHMAP_64BIT)
+  hashmap_uint32_t _;
+#endif
+#elif !defined(HASHMAP_64BIT)
+  hashmap_uint32_t _;
+#endif
   hashmap_hasher_t hasher;
   hashmap_comparer_t comparer;
   struct hashmap_element_s *data;
+  hashmap_uint8_t *control;
+  struct hashmap_element_s *old_data;
+  hashmap_uint8_t *old_control;
+  struct hashmap_allocator_s allocator;
+  struct hashmap_key_block_s *keys;
+#if 0 < HASHMAP_SMALL_SIZE
+  struct hashmap_element_s inline_data[HASHMAP_SMALL_SIZE];
+#endif
 } hashmap_t;
 
+#define HASHMAP_CACHE_LINE_SIZE (64)
+
+/* The default probe window is 8 elements, which with 32-byte elements is four
+ * cache lines. Probing only reads the control bytes, so inline keys and the
+ * 64-bit key length and hash make the elements bigger without making a window
+ * any more expensive to search, and do not change it. It is also one of the
+ * window lengths that lookups have a specialized path for. */
 #define HASHMAP_LINEAR_PROBE_LENGTH (8)
 
+/* Each element has a matching control byte, which is either
+ * HASHMAP_CONTROL_EMPTY or the low 7 bits of the element's hash. Control bytes
+ * are matched HASHMAP_CONTROL_GROUP_SIZE at a time so that the comparer only
+ * has to be called for elements whose tag matches. */
+#define HASHMAP_CONTROL_EMPTY (0x80)
+#define HASHMAP_CONTROL_GROUP_SIZE (16)
+
+/* Use Robin Hood insertion and backward-shift deletion instead of taking the
+ * first free element in the probe window. This also lets lookups for missing
+ * keys stop at the first free element instead of checking the whole window. */
+#define HASHMAP_FLAG_ROBIN_HOOD (0x1u)
+
+/* Grow by moving the elements into the bigger table a few at a time, rather
+ * than all at once in the put that ran out of room. */
+#define HASHMAP_FLAG_INCREMENTAL (0x2u)
+
+/* Shrink the hashmap when removes leave it at a quarter of the capacity it
+ * needs. It is shrunk to twice what it needs, so that a hashmap whose size
+ * hovers around one capacity does not keep growing and shrinking. */
+#define HASHMAP_FLAG_AUTO_SHRINK (0x4u)
+
+/* Keep the first HASHMAP_SMALL_SIZE entries inline in the hashmap, where they
+ * are searched without hashing, and only allocate a table when there are more
+ * than that. Unless HASHMAP_SMALL_SIZE is defined the flag is ignored: the
+ * hashmap is created without it, and allocates a table like any other. */
+#define HASHMAP_FLAG_SMALL (0x8u)
+
+/* Copy keys into memory owned by the hashmap, rather than keeping the pointer
+ * that was passed to hashmap_put. */
+#define HASHMAP_FLAG_OWN_KEYS (0x10u)
+
+/* Map tables of at least HASHMAP_HUGE_PAGE_SIZE bytes straight from the
+ * operating system and back them with huge pages where it has them, so that
+ * lookups in a big table miss the TLB less often. */
+#define HASHMAP_FLAG_HUGE_PAGES (0x20u)
+
+/* Map tables of at least HASHMAP_HUGE_PAGE_SIZE bytes straight from the
+ * operating system and fault all of their pages in up front, rather than
+ * taking a page fault the first time each page is written. */
+#define HASHMAP_FLAG_PREFAULT (0x40u)
+
+/* The size of a huge page, which must be a power of two. Mapped tables are
+ * rounded up to a multiple of it, and explicit huge pages are asked for at
+ * exactly this size rather than whatever the system's default is, so a system
+ * with no huge pages of this size gets transparent huge pages instead. */
+#if !defined(HASHMAP_HUGE_PAGE_SIZE)
+#define HASHMAP_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#endif
+
+#if 0 != (HASHMAP_HUGE_PAGE_SIZE & (HASHMAP_HUGE_PAGE_SIZE - 1))
+#error HASHMAP_HUGE_PAGE_SIZE must be a power of two!
+#endif
+
+/* The smallest block of key memory a hashmap with HASHMAP_FLAG_OWN_KEYS
+ * allocates. Each block after the first is twice the size of the last. */
+#define HASHMAP_KEY_BLOCK_SIZE (256)
+
+/* How many keys hashmap_get_batch and hashmap_put_batch have in flight at
+ * once. */
+#define HASHMAP_BATCH_SIZE (16)
+
+/* How many slots of the old table each put or remove moves across while an
+ * incremental grow is in progress. */
+#define HASHMAP_MIGRATE_STEP (64)
+
+/* Where an element is stored, made by hashmap_get_slot. The members should be
+ * treated as private. */
+typedef struct hashmap_slot_s {
+  hashmap_size_t index;
+  hashmap_uint32_t old;
+  hashmap_uint32_t generation;
+} hashmap_slot_t;
+
+/* A key along with its hash, made by hashmap_hash_key. The members should be
+ * treated as private. */
+typedef struct hashmap_prehashed_s {
+  const void *key;
+  hashmap_size_t len;
+  hashmap_hash_t hash;
+  hashmap_hasher_t hasher;
+} hashmap_prehashed_t;
+
 typedef struct hashmap_create_options_s {
   hashmap_hasher_t hasher;
   hashmap_comparer_t comparer;
-  hashmap_uint32_t initial_capacity;
-  hashmap_uint32_t _;
+  hashmap_size_t initial_capacity;
+  hashmap_uint32_t flags;
+  hashmap_uint32_t probe_length;
+  hashmap_size_t expected_entries;
+  struct hashmap_allocator_s allocator;
 } hashmap_create_options_t;
 
 #if defined(__cplusplus)
@@ -163,7 +475,7 @@ extern "C" {
 /// @param initial_capacity The initial capacity of the hashmap.
 /// @param out_hashmap The storage for the created hashmap.
 /// @return On success 0 is returned.
-HASHMAP_WEAK int hashmap_create(const hashmap_uint32_t initial_capacity,
+HASHMAP_WEAK int hashmap_create(const hashmap_size_t initial_capacity,
                                 struct hashmap_s *const out_hashmap);
 
 /// @brief Create a hashmap.
@@ -174,10 +486,77 @@ HASHMAP_WEAK int hashmap_create(const hashmap_uint32_t initial_capacity,
 /// The options members work as follows:
 /// - initial_capacity The initial capacity of the hashmap.
 /// - hasher Which hashing function to use with the hashmap (by default the
-//    crc32 with Robert Jenkins' mix is used).
+//    crc32 with Robert Jenkins' mix is used). hashmap_mum_hasher and
+///   hashmap_stripes_hasher are built in too.
+/// - flags A combination of HASHMAP_FLAG_* values. HASHMAP_FLAG_ROBIN_HOOD
+///   keeps every element as close to its ideal slot as the others around it,
+///   which lets the hashmap fill much further before it has to grow, and lets
+///   lookups of missing keys stop at the first free element they see.
+///   HASHMAP_FLAG_INCREMENTAL spreads the cost of growing the hashmap across
+///   the puts and removes that follow, rather than paying it all in one put.
+///   HASHMAP_FLAG_AUTO_SHRINK shrinks the hashmap when removes leave it mostly
+///   empty. HASHMAP_FLAG_SMALL keeps up to HASHMAP_SMALL_SIZE entries inside the
+///   hashmap itself, so that small hashmaps never allocate or hash their keys.
+///   Unless HASHMAP_SMALL_SIZE is defined it is ignored, and is not set in the
+///   flags of the hashmap that is created.
+///   The elements then live in the struct hashmap_s, so such a hashmap must
+///   not be copied by value once it has been created. HASHMAP_FLAG_OWN_KEYS
+///   copies each key into memory owned by the hashmap, where the keys are
+///   packed together and repacked whenever the hashmap is resized.
+///   HASHMAP_FLAG_HUGE_PAGES and HASHMAP_FLAG_PREFAULT map tables of at least
+///   HASHMAP_HUGE_PAGE_SIZE bytes directly with mmap rather than allocating
+///   them, backed by huge pages or with every page faulted in up front. Where
+///   mmap is not available they have no effect.
+/// - probe_length How many elements after its ideal slot an element may be
+///   stored in. Longer windows let the hashmap fill further before it grows at
+///   the cost of slower lookups (by default HASHMAP_LINEAR_PROBE_LENGTH).
+/// - expected_entries How many entries the hashmap is expected to hold. The
+///   initial capacity is raised as if hashmap_reserve had been called with it.
+/// - allocator The functions every allocation the hashmap makes goes through
+///   (by default malloc, realloc and free). Allocate and deallocate must both
+///   be set or both be left unset, or an error is returned. Reallocate can be
+///   left unset in which case allocate and deallocate are used instead, but
+///   cannot be set without them.
 HASHMAP_WEAK int hashmap_create_ex(struct hashmap_create_options_s options,
                                    struct hashmap_s *const out_hashmap);
 
+/// @brief Grow the hashmap so that it can hold a number of entries.
+/// @param hashmap The hashmap to grow.
+/// @param num_entries The total number of entries the hashmap should hold.
+/// @return On success 0 is returned.
+///
+/// The hashmap is grown at most once, to a capacity at which its probe windows
+/// do not overflow before num_entries are put into it with a well distributed
+/// hash. The hashmap is never shrunk.
+HASHMAP_WEAK int hashmap_reserve(struct hashmap_s *const hashmap,
+                                 const hashmap_size_t num_entries);
+
+/// @brief Shrink the hashmap to fit the entries it holds.
+/// @param hashmap The hashmap to shrink.
+/// @return On success 0 is returned.
+///
+/// The hashmap is shrunk to the capacity that hashmap_reserve would have given
+/// it for its current number of entries, or the smallest capacity above that
+/// which its entries fit in.
+HASHMAP_WEAK int hashmap_shrink_to_fit(struct hashmap_s *const hashmap);
+
+/// @brief Remove every element from the hashmap.
+/// @param hashmap The hashmap to clear.
+///
+/// The hashmap keeps its capacity, and only its control bytes are touched.
+HASHMAP_WEAK void hashmap_clear(struct hashmap_s *const hashmap);
+
+/// @brief Remove every element from the hashmap and shrink it.
+/// @param hashmap The hashmap to clear.
+/// @param num_entries The number of entries the hashmap should still hold
+/// without growing.
+/// @return On success 0 is returned.
+///
+/// If the hashmap is bigger than the capacity hashmap_reserve would give it
+/// for num_entries, it is shrunk to that capacity. It is never grown.
+HASHMAP_WEAK int hashmap_clear_and_shrink(struct hashmap_s *const hashmap,
+                                          const hashmap_size_t num_entries);
+
 /// @brief Put an element into the hashmap.
 /// @param hashmap The hashmap to insert into.
 /// @param key The string key to use.
@@ -187,11 +566,36 @@ HASHMAP_WEAK int hashmap_create_ex(struct hashmap_create_options_s options,
 ///
 /// The key string slice is not copied when creating the hashmap entry, and thus
 /// must remain a valid pointer until the hashmap entry is removed or the
-/// hashmap is destroyed.
+/// hashmap is destroyed. If the hashmap was created with HASHMAP_FLAG_OWN_KEYS
+/// the key is copied instead, and can be freed as soon as this returns.
 HASHMAP_WEAK int hashmap_put(struct hashmap_s *const hashmap,
-                             const void *const key, const hashmap_uint32_t len,
+                             const void *const key, const hashmap_size_t len,
                              void *const value);
 
+/// @brief Put many elements into the hashmap at once.
+/// @param hashmap The hashmap to insert into.
+/// @param keys The string keys to use.
+/// @param lens The lengths of the string keys.
+/// @param values The values to insert, one for each key.
+/// @param num_keys The number of keys.
+/// @param out_results Where to store what hashmap_put would have returned for
+/// each key, or NULL if only the overall result is wanted.
+/// @return On success 0 is returned, or 1 if any of the puts failed.
+///
+/// This gives the same results as calling hashmap_put on each key in turn
+/// (so a later key replaces an earlier equal one), but works on
+/// HASHMAP_BATCH_SIZE keys at a time. It reserves room for each of those
+/// first, along with as many of the keys after them as have been new so far,
+/// then hashes all of them and fetches the window each one will land in
+/// before inserting any of them. A hashmap that grows incrementally is left to
+/// grow as it goes.
+HASHMAP_WEAK int hashmap_put_batch(struct hashmap_s *const hashmap,
+                                   const void *const *const keys,
+                                   const hashmap_size_t *const lens,
+                                   void *const *const values,
+                                   const hashmap_size_t num_keys,
+                                   int *const out_results);
+
 /// @brief Get an element from the hashmap.
 /// @param hashmap The hashmap to get from.
 /// @param key The string key to use.
@@ -199,7 +603,61 @@ HASHMAP_WEAK int hashmap_put(struct hashmap_s *const hashmap,
 /// @return The previously set element, or NULL if none exists.
 HASHMAP_WEAK void *hashmap_get(const struct hashmap_s *const hashmap,
                                const void *const key,
-                               const hashmap_uint32_t len);
+                               const hashmap_size_t len);
+
+/// @brief Get many elements from the hashmap at once.
+/// @param hashmap The hashmap to get from.
+/// @param keys The string keys to use.
+/// @param lens The lengths of the string keys.
+/// @param num_keys The number of keys.
+/// @param out_values Where to store the element for each key, or NULL for
+/// each key that has none.
+///
+/// This gives the same results as calling hashmap_get on each key, but works
+/// on HASHMAP_BATCH_SIZE keys at a time, hashing all of them and fetching the
+/// memory each one needs before looking any of them up. That way the cache
+/// misses of the whole batch overlap, rather than being paid one after another.
+HASHMAP_WEAK void hashmap_get_batch(const struct hashmap_s *const hashmap,
+                                    const void *const *const keys,
+                                    const hashmap_size_t *const lens,
+                                    const hashmap_size_t num_keys,
+                                    void **const out_values);
+
+/// @brief Get an element and the key it was stored with.
+/// @param hashmap The hashmap to get from.
+/// @param key The string key to use.
+/// @param len The length of the string key.
+/// @param out_key Where to store the key the element was put with, or NULL.
+/// @param out_value Where to store the element, or NULL.
+/// @return 0 if the element exists, and non-zero if not.
+///
+/// Unlike hashmap_get this tells an element that was set to NULL apart from one
+/// that does not exist. As with hashmap_remove_and_return_key, the key of a
+/// hashmap created with HASHMAP_FLAG_OWN_KEYS is the hashmap's own copy.
+HASHMAP_WEAK int hashmap_get_key_value(const struct hashmap_s *const hashmap,
+                                       const void *const key,
+                                       const hashmap_size_t len,
+                                       const void **const out_key,
+                                       void **const out_value);
+
+/// @brief Get where an element is stored, putting it into the hashmap first if
+/// it is not already there.
+/// @param hashmap The hashmap to get from or insert into.
+/// @param key The string key to use.
+/// @param len The length of the string key.
+/// @param out_inserted Where to store 1 if the element was inserted, or 0 if it
+/// already existed. Can be NULL.
+/// @return A pointer to the value of the element, which is NULL for one that
+/// was just inserted, or NULL on failure.
+///
+/// This hashes the key and searches for it once, so that updating an element
+/// in place (such as bumping a counter) costs a single lookup rather than a
+/// hashmap_get followed by a hashmap_put. The pointer is only valid until the
+/// hashmap is next modified.
+HASHMAP_WEAK void **hashmap_get_or_insert(struct hashmap_s *const hashmap,
+                                          const void *const key,
+                                          const hashmap_size_t len,
+                                          int *const out_inserted);
 
 /// @brief Remove an element from the hashmap.
 /// @param hashmap The hashmap to remove from.
@@ -208,7 +666,7 @@ HASHMAP_WEAK void *hashmap_get(const struct hashmap_s *const hashmap,
 /// @return On success 0 is returned.
 HASHMAP_WEAK int hashmap_remove(struct hashmap_s *const hashmap,
                                 const void *const key,
-                                const hashmap_uint32_t len);
+                                const hashmap_size_t len);
 
 /// @brief Remove an element from the hashmap.
 /// @param hashmap The hashmap to remove from.
@@ -216,10 +674,134 @@ HASHMAP_WEAK int hashmap_remove(struct hashmap_s *const hashmap,
 /// @param len The length of the string key.
 /// @return On success the original stored key pointer is returned, on failure
 /// NULL is returned.
+///
+/// If the hashmap was created with HASHMAP_FLAG_OWN_KEYS the returned key is
+/// the hashmap's own copy. It must not be freed, and is only valid until the
+/// hashmap is next modified.
 HASHMAP_WEAK const void *
 hashmap_remove_and_return_key(struct hashmap_s *const hashmap,
                               const void *const key,
-                              const hashmap_uint32_t len);
+                              const hashmap_size_t len);
+
+/// @brief Find where an element is stored.
+/// @param hashmap The hashmap to look in.
+/// @param key The string key to use.
+/// @param len The length of the string key.
+/// @param out_slot The storage for where the element is.
+/// @return 0 if the element exists, and non-zero if not.
+///
+/// The slot can be passed to hashmap_get_at, hashmap_update_at and
+/// hashmap_remove_at to use the element without hashing and comparing its key
+/// again. It is only valid until the hashmap is next modified, other than by
+/// hashmap_update_at. If HASHMAP_DEBUG is defined the hashmap counts its
+/// modifications, and the functions taking a slot that is no longer valid fail
+/// rather than use whatever element is now stored there.
+HASHMAP_WEAK int hashmap_get_slot(const struct hashmap_s *const hashmap,
+                                  const void *const key,
+                                  const hashmap_size_t len,
+                                  struct hashmap_slot_s *const out_slot);
+
+/// @brief Get the element in a slot.
+/// @param hashmap The hashmap the slot is in.
+/// @param slot The slot, from hashmap_get_slot.
+/// @return The element, or NULL if the slot is found to be stale.
+HASHMAP_WEAK void *hashmap_get_at(const struct hashmap_s *const hashmap,
+                                  const struct hashmap_slot_s *const slot);
+
+/// @brief Replace the element in a slot.
+/// @param hashmap The hashmap the slot is in.
+/// @param slot The slot, from hashmap_get_slot.
+/// @param value The value to store in the slot.
+/// @return On success 0 is returned.
+///
+/// The key of the element is left as it is, and the slot stays valid.
+HASHMAP_WEAK int hashmap_update_at(struct hashmap_s *const hashmap,
+                                   const struct hashmap_slot_s *const slot,
+                                   void *const value);
+
+/// @brief Remove the element in a slot.
+/// @param hashmap The hashmap the slot is in.
+/// @param slot The slot, from hashmap_get_slot.
+/// @param out_key Where to store the key the element was put with, or NULL.
+/// @return On success 0 is returned.
+///
+/// As with hashmap_remove_and_return_key, the key of a hashmap created with
+/// HASHMAP_FLAG_OWN_KEYS is the hashmap's own copy.
+HASHMAP_WEAK int hashmap_remove_at(struct hashmap_s *const hashmap,
+                                   const struct hashmap_slot_s *const slot,
+                                   const void **const out_key);
+
+/// @brief Hash a key once so that it can be used many times.
+/// @param hashmap The hashmap whose hasher to use.
+/// @param key The string key to use.
+/// @param len The length of the string key.
+/// @param out_prehashed The storage for the key and its hash.
+/// @return On success 0 is returned.
+///
+/// The result can be passed to hashmap_get_prehashed, hashmap_put_prehashed
+/// and hashmap_remove_prehashed of this or any other hashmap, for as long as
+/// the key it points to is valid. A hashmap with a different hasher than the
+/// one that made it hashes the key again, so the result is always the same as
+/// using the key directly.
+HASHMAP_WEAK int
+hashmap_hash_key(const struct hashmap_s *const hashmap, const void *const key,
+                 const hashmap_size_t len,
+                 struct hashmap_prehashed_s *const out_prehashed);
+
+/// @brief Put an element into the hashmap with a prehashed key.
+/// @param hashmap The hashmap to insert into.
+/// @param prehashed The key, from hashmap_hash_key.
+/// @param value The value to insert.
+/// @return On success 0 is returned.
+HASHMAP_WEAK int
+hashmap_put_prehashed(struct hashmap_s *const hashmap,
+                      const struct hashmap_prehashed_s *const prehashed,
+                      void *const value);
+
+/// @brief Get an element from the hashmap with a prehashed key.
+/// @param hashmap The hashmap to get from.
+/// @param prehashed The key, from hashmap_hash_key.
+/// @return The previously set element, or NULL if none exists.
+HASHMAP_WEAK void *
+hashmap_get_prehashed(const struct hashmap_s *const hashmap,
+                      const struct hashmap_prehashed_s *const prehashed);
+
+/// @brief Remove an element from the hashmap with a prehashed key.
+/// @param hashmap The hashmap to remove from.
+/// @param prehashed The key, from hashmap_hash_key.
+/// @return On success 0 is returned.
+HASHMAP_WEAK int
+hashmap_remove_prehashed(struct hashmap_s *const hashmap,
+                         const struct hashmap_prehashed_s *const prehashed);
+
+/// @brief Put an element into the hashmap with an integer key.
+/// @param hashmap The hashmap to insert into.
+/// @param key The integer key to use.
+/// @param value The value to insert.
+/// @return On success 0 is returned.
+///
+/// The key is copied into memory owned by the hashmap, and is hashed and
+/// compared as an integer rather than with the hasher and comparer of the
+/// hashmap. A hashmap should only be used with either integer keys or string
+/// slice keys. In hashmap_iterate_pairs an element with an integer key has a
+/// key_len of 0, and its key points at the 8 bytes of the integer.
+HASHMAP_WEAK int hashmap_put_u64(struct hashmap_s *const hashmap,
+                                 const hashmap_uint64_t key,
+                                 void *const value);
+
+/// @brief Get an element from the hashmap with an integer key.
+/// @param hashmap The hashmap to get from.
+/// @param key The integer key to use.
+/// @return The previously set element, or NULL if none exists.
+HASHMAP_WEAK void *hashmap_get_u64(const struct hashmap_s *const hashmap,
+                                   const hashmap_uint64_t key);
+
+/// @brief Remove an element from the hashmap with an integer key.
+/// @param hashmap The hashmap to remove from.
+/// @param key The integer key to use.
+/// @return On success 0 is returned.
+HASHMAP_WEAK int hashmap_remove_u64(struct hashmap_s *const hashmap,
+                                    const hashmap_uint64_t key);
 
 /// @brief Iterate over all the elements in a hashmap.
 /// @param hashmap The hashmap to iterate over.
@@ -248,37 +830,321 @@ HASHMAP_WEAK int hashmap_iterate_pairs(
 /// @brief Get the size of the hashmap.
 /// @param hashmap The hashmap to get the size of.
 /// @return The size of the hashmap.
-HASHMAP_ALWAYS_INLINE hashmap_uint32_t
+HASHMAP_ALWAYS_INLINE hashmap_size_t
 hashmap_num_entries(const struct hashmap_s *const hashmap);
 
 /// @brief Get the capacity of the hashmap.
 /// @param hashmap The hashmap to get the size of.
 /// @return The capacity of the hashmap.
-HASHMAP_ALWAYS_INLINE hashmap_uint32_t
+HASHMAP_ALWAYS_INLINE hashmap_size_t
 hashmap_capacity(const struct hashmap_s *const hashmap);
 
 /// @brief Destroy the hashmap.
 /// @param hashmap The hashmap to destroy.
 HASHMAP_WEAK void hashmap_destroy(struct hashmap_s *const hashmap);
 
-static hashmap_uint32_t hashmap_crc32_hasher(const hashmap_uint32_t seed,
-                                             const void *const s,
-                                             const hashmap_uint32_t len);
+/// @brief A hasher that mixes keys 8 bytes at a time with 64-bit multiplies.
+/// @param seed The seed to start hashing from.
+/// @param key The key to hash.
+/// @param len The length of the key.
+/// @return The hash of the key.
+///
+/// In the style of wyhash, but not the same hashes. Keys of up to 16 bytes
+/// take a couple of multiplies no matter the CPU, which makes it the quickest
+/// choice for short keys on CPUs without crc32 instructions. Use it by setting
+/// the hasher member of struct hashmap_create_options_s to it.
+HASHMAP_WEAK hashmap_hash_t hashmap_mum_hasher(const hashmap_hash_t seed,
+                                               const void *const key,
+                                               const hashmap_size_t len);
+
+/// @brief A hasher that mixes long keys 64 bytes at a time with SIMD.
+/// @param seed The seed to start hashing from.
+/// @param key The key to hash.
+/// @param len The length of the key.
+/// @return The hash of the key.
+///
+/// In the style of XXH3, but not the same hashes. Keys longer than 256 bytes
+/// are mixed into eight 64-bit lanes at once (using AVX2, SSE2 or NEON where
+/// available, with the same result either way) and shorter keys are hashed as
+/// hashmap_mum_hasher would. It is quickest for long keys when built with
+/// AVX2. Use it by setting the hasher member of struct
+/// hashmap_create_options_s to it.
+HASHMAP_WEAK hashmap_hash_t hashmap_stripes_hasher(const hashmap_hash_t seed,
+                                                   const void *const key,
+                                                   const hashmap_size_t len);
+
+#if defined(HASHMAP_64BIT)
+static hashmap_hash_t hashmap_mix64_hasher(const hashmap_hash_t seed,
+                                           const void *const s,
+                                           const hashmap_size_t len);
+#else
+static hashmap_hash_t hashmap_crc32_hasher(const hashmap_hash_t seed,
+                                           const void *const s,
+                                           const hashmap_size_t len);
+#endif
 static int hashmap_memcmp_comparer(const void *const a,
-                                   const hashmap_uint32_t a_len,
+                                   const hashmap_size_t a_len,
                                    const void *const b,
-                                   const hashmap_uint32_t b_len);
-HASHMAP_ALWAYS_INLINE hashmap_uint32_t hashmap_hash_helper_int_helper(
+                                   const hashmap_size_t b_len);
+static void *hashmap_default_allocate(void *const context, const size_t size);
+static void *hashmap_default_reallocate(void *const context,
+                                        void *const pointer,
+                                        const size_t old_size,
+                                        const size_t new_size);
+static void hashmap_default_deallocate(void *const context,
+                                       void *const pointer, const size_t size);
+HASHMAP_ALWAYS_INLINE struct hashmap_element_s *
+hashmap_alloc_helper(const struct hashmap_s *const m,
+                     const hashmap_size_t slots);
+HASHMAP_ALWAYS_INLINE struct hashmap_element_s *
+hashmap_realloc_helper(const struct hashmap_s *const m,
+                       struct hashmap_element_s *const data,
+                       const hashmap_size_t old_slots,
+                       const hashmap_size_t new_slots);
+HASHMAP_ALWAYS_INLINE int hashmap_mapped_helper(const struct hashmap_s *const m,
+                                                const size_t size);
+HASHMAP_ALWAYS_INLINE void *hashmap_map_helper(const hashmap_uint32_t flags,
+                                               const size_t size);
+HASHMAP_ALWAYS_INLINE void hashmap_unmap_helper(void *const pointer,
+                                                const size_t size);
+HASHMAP_ALWAYS_INLINE void
+hashmap_free_helper(const struct hashmap_s *const m,
+                    struct hashmap_element_s *const data,
+                    const hashmap_size_t slots);
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_num_slots(const struct hashmap_s *const m);
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_old_num_slots(const struct hashmap_s *const m);
+HASHMAP_ALWAYS_INLINE size_t hashmap_table_size(const hashmap_size_t slots);
+HASHMAP_ALWAYS_INLINE size_t
+hashmap_elements_size(const hashmap_size_t slots);
+HASHMAP_ALWAYS_INLINE hashmap_uint8_t *
+hashmap_table_control(struct hashmap_element_s *const data,
+                      const hashmap_size_t slots);
+HASHMAP_ALWAYS_INLINE size_t hashmap_align_helper(const void *const pointer);
+HASHMAP_ALWAYS_INLINE hashmap_uint32_t
+hashmap_load_factor_helper(const hashmap_uint32_t flags,
+                           const hashmap_uint32_t probe_length);
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_max_entries_helper(const hashmap_uint32_t load_factor,
+                           const hashmap_size_t capacity);
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_reserve_capacity_helper(const hashmap_uint32_t flags,
+                                const hashmap_uint32_t probe_length,
+                                const hashmap_size_t num_entries);
+HASHMAP_ALWAYS_INLINE hashmap_size_t hashmap_hash_helper_int_helper(
+    const struct hashmap_s *const m, const hashmap_hash_t hash);
+HASHMAP_ALWAYS_INLINE hashmap_uint8_t
+hashmap_control_tag(const hashmap_hash_t hash);
+HASHMAP_ALWAYS_INLINE hashmap_uint32_t
+hashmap_match_control(const hashmap_uint8_t *const control,
+                      const hashmap_uint8_t tag);
+HASHMAP_ALWAYS_INLINE hashmap_uint32_t
+hashmap_match_half_control(const hashmap_uint8_t *const control,
+                           const hashmap_uint8_t tag);
+HASHMAP_ALWAYS_INLINE hashmap_uint32_t
+hashmap_match_group(const struct hashmap_s *const m,
+                    const hashmap_size_t index, const hashmap_uint8_t tag,
+                    const hashmap_uint32_t length);
+HASHMAP_ALWAYS_INLINE hashmap_size_t hashmap_find_group_helper(
     const struct hashmap_s *const m, const void *const key,
-    const hashmap_uint32_t len);
+    const hashmap_size_t len, const hashmap_hash_t hash,
+    const hashmap_size_t index, const hashmap_uint32_t length);
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_find_helper(const struct hashmap_s *const m, const void *const key,
+                    const hashmap_size_t len, const hashmap_hash_t hash);
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_probe_distance(const struct hashmap_s *const m,
+                       const hashmap_size_t index);
+HASHMAP_ALWAYS_INLINE int
+hashmap_robin_hood_helper(struct hashmap_s *const m,
+                          const hashmap_hash_t hash,
+                          hashmap_size_t *const out_index);
+HASHMAP_ALWAYS_INLINE int
+hashmap_insert_helper(struct hashmap_s *const m, const hashmap_hash_t hash,
+                      hashmap_size_t *const out_index);
+HASHMAP_ALWAYS_INLINE int
+hashmap_hash_helper(struct hashmap_s *const m, const hashmap_hash_t hash,
+                    hashmap_size_t *const out_index);
+HASHMAP_ALWAYS_INLINE struct hashmap_element_s *
+hashmap_entry_helper(struct hashmap_s *const m, const void *const key,
+                     const hashmap_size_t len, const hashmap_hash_t hash,
+                     int *const out_inserted);
+HASHMAP_ALWAYS_INLINE void
+hashmap_free_element_helper(struct hashmap_s *const m, hashmap_size_t index);
+HASHMAP_ALWAYS_INLINE void hashmap_erase_helper(struct hashmap_s *const m,
+                                                const hashmap_size_t index);
+HASHMAP_ALWAYS_INLINE void
+hashmap_old_table_helper(const struct hashmap_s *const m,
+                         struct hashmap_s *const out_old);
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_find_old_helper(const struct hashmap_s *const m, const void *const key,
+                        const hashmap_size_t len,
+                        const hashmap_hash_t hash);
+HASHMAP_ALWAYS_INLINE void hashmap_erase_old_helper(struct hashmap_s *const m,
+                                                    const hashmap_size_t index);
+HASHMAP_WEAK int hashmap_migrate_helper(struct hashmap_s *const m,
+                                        hashmap_size_t count);
+HASHMAP_WEAK int hashmap_migrate_start_helper(struct hashmap_s *const m);
+HASHMAP_WEAK int hashmap_grow_helper(struct hashmap_s *const m,
+                                     const hashmap_uint32_t log2_capacity);
+HASHMAP_WEAK int hashmap_rehash_helper(struct hashmap_s *const m);
+HASHMAP_WEAK int
+hashmap_rebuild_helper(struct hashmap_s *const m,
+                       const hashmap_uint32_t log2_capacity);
+HASHMAP_WEAK int hashmap_shrink_to_helper(struct hashmap_s *const m,
+                                          const hashmap_size_t capacity);
+HASHMAP_ALWAYS_INLINE void hashmap_auto_shrink_helper(struct hashmap_s *const m);
+#if 0 < HASHMAP_SMALL_SIZE
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_small_find_helper(const struct hashmap_s *const m,
+                          const void *const key, const hashmap_size_t len);
+HASHMAP_ALWAYS_INLINE void
+hashmap_small_erase_helper(struct hashmap_s *const m,
+                           const hashmap_size_t index);
+HASHMAP_WEAK int hashmap_promote_helper(struct hashmap_s *const m,
+                                        const hashmap_size_t capacity);
+HASHMAP_WEAK int hashmap_demote_helper(struct hashmap_s *const m);
+#endif
+HASHMAP_ALWAYS_INLINE struct hashmap_element_s *
+hashmap_entry_key_helper(struct hashmap_s *const m, const void *const key,
+                         const hashmap_size_t len, int *const out_inserted);
+HASHMAP_ALWAYS_INLINE struct hashmap_element_s *
+hashmap_entry_hashed_helper(struct hashmap_s *const m, const void *const key,
+                            const hashmap_size_t len,
+                            const hashmap_hash_t hash,
+                            int *const out_inserted);
+HASHMAP_ALWAYS_INLINE int
+hashmap_put_entry_helper(const struct hashmap_s *const m,
+                         struct hashmap_element_s *const element,
+                         const int inserted, const void *const key,
+                         const hashmap_size_t len, void *const value);
+HASHMAP_ALWAYS_INLINE int
+hashmap_put_key_helper(struct hashmap_s *const m, const void *const key,
+                       const hashmap_size_t len, void *const value);
 HASHMAP_ALWAYS_INLINE int
-hashmap_hash_helper(const struct hashmap_s *const m, const void *const key,
-                    const hashmap_uint32_t len,
-                    hashmap_uint32_t *const out_index);
-HASHMAP_WEAK int hashmap_rehash_iterator(void *const new_hash,
-                                         struct hashmap_element_s *const e);
-HASHMAP_ALWAYS_INLINE int hashmap_rehash_helper(struct hashmap_s *const m);
+hashmap_put_hashed_helper(struct hashmap_s *const m, const void *const key,
+                          const hashmap_size_t len, const hashmap_hash_t hash,
+                          void *const value);
+HASHMAP_ALWAYS_INLINE void *
+hashmap_get_key_helper(const struct hashmap_s *const m, const void *const key,
+                       const hashmap_size_t len);
+HASHMAP_ALWAYS_INLINE void *
+hashmap_get_hashed_helper(const struct hashmap_s *const m,
+                          const void *const key, const hashmap_size_t len,
+                          const hashmap_hash_t hash);
+HASHMAP_ALWAYS_INLINE struct hashmap_element_s *
+hashmap_get_element_helper(const struct hashmap_s *const m,
+                           const void *const key, const hashmap_size_t len,
+                           const hashmap_hash_t hash);
+HASHMAP_ALWAYS_INLINE int
+hashmap_remove_key_helper(struct hashmap_s *const m, const void *const key,
+                          const hashmap_size_t len,
+                          const void **const out_key);
+HASHMAP_ALWAYS_INLINE int
+hashmap_remove_hashed_helper(struct hashmap_s *const m, const void *const key,
+                             const hashmap_size_t len,
+                             const hashmap_hash_t hash,
+                             const void **const out_key);
+HASHMAP_ALWAYS_INLINE hashmap_hash_t hashmap_prehashed_hash_helper(
+    const struct hashmap_s *const m,
+    const struct hashmap_prehashed_s *const prehashed);
+HASHMAP_ALWAYS_INLINE void
+hashmap_invalidate_slots_helper(struct hashmap_s *const m);
+HASHMAP_ALWAYS_INLINE int
+hashmap_slot_valid_helper(const struct hashmap_s *const m,
+                          const struct hashmap_slot_s *const slot);
+HASHMAP_ALWAYS_INLINE hashmap_hash_t
+hashmap_key_hash_helper(const struct hashmap_s *const m, const void *const key,
+                        const hashmap_size_t len);
+HASHMAP_ALWAYS_INLINE int
+hashmap_match_key_helper(const struct hashmap_s *const m,
+                         const struct hashmap_element_s *const element,
+                         const void *const key, const hashmap_size_t len);
+HASHMAP_ALWAYS_INLINE const void *
+hashmap_element_key(const struct hashmap_element_s *const element);
+HASHMAP_ALWAYS_INLINE void
+hashmap_set_key_helper(struct hashmap_element_s *const element,
+                       const void *const key, const hashmap_size_t len);
+HASHMAP_ALWAYS_INLINE void
+hashmap_update_helper(const struct hashmap_s *const m,
+                      struct hashmap_element_s *const element,
+                      const void *const key, const hashmap_size_t len,
+                      void *const value);
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_key_size_helper(const hashmap_size_t len);
+HASHMAP_ALWAYS_INLINE int
+hashmap_copies_key_helper(const struct hashmap_s *const m,
+                          const hashmap_size_t len);
+HASHMAP_WEAK const void *hashmap_copy_key_helper(struct hashmap_s *const m,
+                                                 const void *const key,
+                                                 const hashmap_size_t len);
+HASHMAP_WEAK void hashmap_free_keys_helper(struct hashmap_s *const m,
+                                           struct hashmap_key_block_s *block);
+HASHMAP_WEAK void hashmap_compact_keys_helper(struct hashmap_s *const m);
+HASHMAP_ALWAYS_INLINE hashmap_uint32_t
+hashmap_log2_helper(const hashmap_size_t x);
 HASHMAP_ALWAYS_INLINE hashmap_uint32_t hashmap_clz(const hashmap_uint32_t x);
+HASHMAP_ALWAYS_INLINE hashmap_uint32_t hashmap_ctz(const hashmap_uint32_t x);
+#if defined(HASHMAP_CRC32_STREAMS)
+HASHMAP_ALWAYS_INLINE HASHMAP_CRC32_TARGET hashmap_uint32_t
+hashmap_crc32_u64_helper(const hashmap_uint32_t crc,
+                         const hashmap_uint8_t *const s);
+HASHMAP_ALWAYS_INLINE HASHMAP_CRC32_TARGET hashmap_uint32_t
+hashmap_crc32_shift_helper(const hashmap_uint32_t crc,
+                           const hashmap_uint32_t shift);
+HASHMAP_ALWAYS_INLINE HASHMAP_CRC32_TARGET hashmap_uint32_t
+hashmap_crc32_streams_helper(hashmap_uint32_t crc,
+                             const hashmap_uint8_t *const s,
+                             const hashmap_size_t block,
+                             const hashmap_uint32_t shift_one,
+                             const hashmap_uint32_t shift_two);
+#endif
+#if !defined(HASHMAP_64BIT)
+#if defined(HASHMAP_CRC32_STREAMS)
+HASHMAP_CRC32_INLINE hashmap_uint32_t
+hashmap_crc32_instructions_helper(hashmap_uint32_t crc,
+                                  const hashmap_uint8_t *const s,
+                                  const hashmap_size_t len);
+#endif
+#if defined(HASHMAP_CRC32_DISPATCH)
+HASHMAP_WEAK int hashmap_crc32_supported_helper(void);
+#endif
+HASHMAP_ALWAYS_INLINE hashmap_uint32_t
+hashmap_crc32_table_helper(hashmap_uint32_t crc, const hashmap_uint8_t *const s,
+                           const hashmap_size_t len);
+#endif
+HASHMAP_ALWAYS_INLINE hashmap_uint64_t
+hashmap_mul128_helper(const hashmap_uint64_t a, const hashmap_uint64_t b,
+                      hashmap_uint64_t *const out_high);
+HASHMAP_ALWAYS_INLINE hashmap_uint64_t
+hashmap_mum_helper(const hashmap_uint64_t a, const hashmap_uint64_t b);
+HASHMAP_ALWAYS_INLINE hashmap_uint64_t
+hashmap_read64_helper(const hashmap_uint8_t *const s);
+HASHMAP_ALWAYS_INLINE hashmap_uint64_t
+hashmap_read32_helper(const hashmap_uint8_t *const s);
+HASHMAP_ALWAYS_INLINE hashmap_hash_t
+hashmap_fold_hash_helper(const hashmap_uint64_t hash);
+#if defined(HASHMAP_X86_AVX2)
+HASHMAP_ALWAYS_INLINE __m256i hashmap_stripe_lanes_helper(
+    const __m256i lanes, const hashmap_uint8_t *const s, const __m256i secret);
+#elif defined(HASHMAP_X86_SSE2)
+HASHMAP_ALWAYS_INLINE __m128i hashmap_stripe_lanes_helper(
+    const __m128i lanes, const hashmap_uint8_t *const s, const __m128i secret);
+#elif defined(HASHMAP_ARM_NEON)
+HASHMAP_ALWAYS_INLINE uint64x2_t
+hashmap_stripe_lanes_helper(const uint64x2_t lanes,
+                            const hashmap_uint8_t *const s,
+                            const uint64x2_t secret);
+#endif
+HASHMAP_ALWAYS_INLINE void
+hashmap_stripes_helper(hashmap_uint64_t *const acc,
+                       const hashmap_uint8_t *const s,
+                       const hashmap_uint64_t *const secret,
+                       const hashmap_size_t stripes);
+HASHMAP_ALWAYS_INLINE void
+hashmap_scramble_helper(hashmap_uint64_t *const acc,
+                        const hashmap_uint64_t *const secret);
 
 #if defined(__cplusplus)
 }
@@ -294,7 +1160,11 @@ HASHMAP_ALWAYS_INLINE hashmap_uint32_t hashmap_clz(const hashmap_uint32_t x);
 #define HASHMAP_NULL 0
 #endif
 
-int hashmap_create(const hashmap_uint32_t initial_capacity,
+/* C89 has no 64-bit literals, so 64-bit constants are made from two halves. */
+#define HASHMAP_U64(high, low)                                                 \
+  ((HASHMAP_CAST(hashmap_uint64_t, high) << 32) | (low))
+
+int hashmap_create(const hashmap_size_t initial_capacity,
                    struct hashmap_s *const out_hashmap) {
   struct hashmap_create_options_s options;
   memset(&options, 0, sizeof(options));
@@ -305,237 +1175,2858 @@ int hashmap_create(const hashmap_uint32_t initial_capacity,
 
 int hashmap_create_ex(struct hashmap_create_options_s options,
                       struct hashmap_s *const out_hashmap) {
+  hashmap_size_t num_slots;
+
   if (2 > options.initial_capacity) {
     options.initial_capacity = 2;
   } else if (0 != (options.initial_capacity & (options.initial_capacity - 1))) {
-    options.initial_capacity = 1u
-                               << (32 - hashmap_clz(options.initial_capacity));
+    options.initial_capacity =
+        HASHMAP_CAST(hashmap_size_t, 2)
+        << hashmap_log2_helper(options.initial_capacity);
   }
 
   if (HASHMAP_NULL == options.hasher) {
+#if defined(HASHMAP_64BIT)
+    options.hasher = &hashmap_mix64_hasher;
+#else
     options.hasher = &hashmap_crc32_hasher;
+#endif
   }
 
   if (HASHMAP_NULL == options.comparer) {
     options.comparer = &hashmap_memcmp_comparer;
   }
 
-  out_hashmap->data = HASHMAP_CAST(
-      struct hashmap_element_s *,
-      calloc(options.initial_capacity + HASHMAP_LINEAR_PROBE_LENGTH,
-             sizeof(struct hashmap_element_s)));
-
-  out_hashmap->log2_capacity = 31 - hashmap_clz(options.initial_capacity);
-  out_hashmap->size = 0;
-  out_hashmap->hasher = options.hasher;
-  out_hashmap->comparer = options.comparer;
+  if (0 == options.probe_length) {
+    options.probe_length =
+        HASHMAP_CAST(hashmap_size_t, HASHMAP_LINEAR_PROBE_LENGTH);
+  }
 
-  return 0;
-}
+  if (0 != options.expected_entries) {
+    const hashmap_size_t capacity = hashmap_reserve_capacity_helper(
+        options.flags, options.probe_length, options.expected_entries);
 
-int hashmap_put(struct hashmap_s *const m, const void *const key,
-                const hashmap_uint32_t len, void *const value) {
-  hashmap_uint32_t index;
+    if (capacity > options.initial_capacity) {
+      options.initial_capacity = capacity;
+    }
+  }
 
-  if ((HASHMAP_NULL == key) || (0 == len)) {
+  if ((HASHMAP_NULL == options.allocator.allocate) !=
+      (HASHMAP_NULL == options.allocator.deallocate)) {
+    /* Memory from one allocator cannot be given back to another. */
     return 1;
   }
 
-  /* Find a place to put our value. */
-  while (!hashmap_hash_helper(m, key, len, &index)) {
-    if (hashmap_rehash_helper(m)) {
+  if (HASHMAP_NULL == options.allocator.allocate) {
+    if (HASHMAP_NULL != options.allocator.reallocate) {
       return 1;
     }
+
+    options.allocator.allocate = &hashmap_default_allocate;
+    options.allocator.reallocate = &hashmap_default_reallocate;
+    options.allocator.deallocate = &hashmap_default_deallocate;
   }
 
-  /* Set the data. */
-  m->data[index].data = value;
-  m->data[index].key = key;
-  m->data[index].key_len = len;
+  num_slots = options.initial_capacity + options.probe_length;
+
+#if 0 == HASHMAP_SMALL_SIZE
+  /* Without the inline elements a small hashmap is just a hashmap. */
+  options.flags &= ~HASHMAP_FLAG_SMALL;
+#endif
+
+  out_hashmap->allocator = options.allocator;
+  out_hashmap->flags = options.flags;
+  out_hashmap->keys = HASHMAP_NULL;
+
+  if ((options.flags & HASHMAP_FLAG_SMALL) &&
+      (HASHMAP_SMALL_SIZE >= options.initial_capacity)) {
+    /* The table is only allocated once the inline elements run out. */
+    out_hashmap->data = HASHMAP_NULL;
+    out_hashmap->control = HASHMAP_NULL;
+    options.initial_capacity = HASHMAP_SMALL_SIZE;
+  } else {
+    out_hashmap->data = hashmap_alloc_helper(out_hashmap, num_slots);
+
+    if (HASHMAP_NULL == out_hashmap->data) {
+      return 1;
+    }
 
-  /* If the hashmap element was not already in use, set that it is being used
-   * and bump our size. */
-  if (0 == m->data[index].in_use) {
-    m->data[index].in_use = 1;
-    m->size++;
+    out_hashmap->control =
+        hashmap_table_control(out_hashmap->data, num_slots);
+    memset(out_hashmap->control, HASHMAP_CONTROL_EMPTY,
+           num_slots + HASHMAP_CONTROL_GROUP_SIZE);
   }
 
+  out_hashmap->log2_capacity = hashmap_log2_helper(options.initial_capacity);
+  out_hashmap->size = 0;
+  out_hashmap->probe_length = options.probe_length;
+  out_hashmap->hasher = options.hasher;
+  out_hashmap->comparer = options.comparer;
+  out_hashmap->old_data = HASHMAP_NULL;
+  out_hashmap->old_control = HASHMAP_NULL;
+  out_hashmap->old_log2_capacity = 0;
+  out_hashmap->migrate_index = 0;
+  out_hashmap->shrink_limit = HASHMAP_SIZE_MAX;
+#if defined(HASHMAP_DEBUG)
+  out_hashmap->generation = 0;
+#if defined(HASHMAP_64BIT)
+  out_hashmap->_ = 0;
+#endif
+#elif !defined(HASHMAP_64BIT)
+  out_hashmap->_ = 0;
+#endif
+
   return 0;
 }
 
-void *hashmap_get(const struct hashmap_s *const m, const void *const key,
-                  const hashmap_uint32_t len) {
-  hashmap_uint32_t i, curr;
+int hashmap_reserve(struct hashmap_s *const m,
+                    const hashmap_size_t num_entries) {
+  const hashmap_size_t capacity =
+      hashmap_reserve_capacity_helper(m->flags, m->probe_length, num_entries);
 
-  if ((HASHMAP_NULL == key) || (0 == len)) {
-    return HASHMAP_NULL;
+  hashmap_invalidate_slots_helper(m);
+
+#if 0 < HASHMAP_SMALL_SIZE
+  if (HASHMAP_NULL == m->data) {
+    return (HASHMAP_SMALL_SIZE >= num_entries)
+               ? 0
+               : hashmap_promote_helper(m, capacity);
   }
+#endif
 
-  curr = hashmap_hash_helper_int_helper(m, key, len);
+  if (capacity <= hashmap_capacity(m)) {
+    return 0;
+  }
 
-  /* Linear probing, if necessary */
-  for (i = 0; i < HASHMAP_LINEAR_PROBE_LENGTH; i++) {
-    const hashmap_uint32_t index = curr + i;
+  /* A reserve is asked for up front, so it does not need to be incremental. */
+  if (HASHMAP_NULL != m->old_data) {
+    if (hashmap_migrate_helper(m, HASHMAP_SIZE_MAX)) {
+      return 1;
+    }
 
-    if (m->data[index].in_use) {
-      if (m->comparer(m->data[index].key, m->data[index].key_len, key, len)) {
-        return m->data[index].data;
-      }
+    if (capacity <= hashmap_capacity(m)) {
+      return 0;
     }
   }
 
-  /* Not found */
-  return HASHMAP_NULL;
-}
-
-int hashmap_remove(struct hashmap_s *const m, const void *const key,
-                   const hashmap_uint32_t len) {
-  hashmap_uint32_t i, curr;
-
-  if ((HASHMAP_NULL == key) || (0 == len)) {
+  if (hashmap_grow_helper(m, hashmap_log2_helper(capacity))) {
     return 1;
   }
 
-  curr = hashmap_hash_helper_int_helper(m, key, len);
+  hashmap_compact_keys_helper(m);
 
-  /* Linear probing, if necessary */
-  for (i = 0; i < HASHMAP_LINEAR_PROBE_LENGTH; i++) {
-    const hashmap_uint32_t index = curr + i;
+  return 0;
+}
 
-    if (m->data[index].in_use) {
-      if (m->comparer(m->data[index].key, m->data[index].key_len, key, len)) {
-        /* Blank out the fields including in_use */
-        memset(&m->data[index], 0, sizeof(struct hashmap_element_s));
+int hashmap_shrink_to_fit(struct hashmap_s *const m) {
+  hashmap_invalidate_slots_helper(m);
 
-        /* Reduce the size */
-        m->size--;
+  if (HASHMAP_NULL == m->data) {
+    return 0;
+  }
 
-        return 0;
-      }
+  if (HASHMAP_NULL != m->old_data) {
+    if (hashmap_migrate_helper(m, HASHMAP_SIZE_MAX)) {
+      return 1;
     }
   }
 
-  return 1;
+  if (hashmap_shrink_to_helper(
+          m,
+          hashmap_reserve_capacity_helper(m->flags, m->probe_length, m->size))) {
+    return 1;
+  }
+
+  hashmap_compact_keys_helper(m);
+
+  return 0;
 }
 
-const void *hashmap_remove_and_return_key(struct hashmap_s *const m,
-                                          const void *const key,
-                                          const hashmap_uint32_t len) {
-  hashmap_uint32_t i, curr;
+void hashmap_clear(struct hashmap_s *const m) {
+  hashmap_invalidate_slots_helper(m);
 
-  if ((HASHMAP_NULL == key) || (0 == len)) {
-    return HASHMAP_NULL;
+  /* Keep the newest key block, as it is the biggest. */
+  if (HASHMAP_NULL != m->keys) {
+    hashmap_free_keys_helper(m, m->keys->next);
+    m->keys->next = HASHMAP_NULL;
+    m->keys->used = 0;
   }
 
-  curr = hashmap_hash_helper_int_helper(m, key, len);
+  if (HASHMAP_NULL == m->data) {
+    m->size = 0;
+    return;
+  }
 
-  /* Linear probing, if necessary */
-  for (i = 0; i < HASHMAP_LINEAR_PROBE_LENGTH; i++) {
-    const hashmap_uint32_t index = curr + i;
+  hashmap_free_helper(m, m->old_data,
+                      hashmap_old_num_slots(m));
+  m->old_data = HASHMAP_NULL;
+  m->old_control = HASHMAP_NULL;
+  m->old_log2_capacity = 0;
+  m->migrate_index = 0;
 
-    if (m->data[index].in_use) {
-      if (m->comparer(m->data[index].key, m->data[index].key_len, key, len)) {
-        const void *const stored_key = m->data[index].key;
+  /* The elements themselves are left as they are, everything that looks at
+   * them checks the control byte first. */
+  memset(m->control, HASHMAP_CONTROL_EMPTY, hashmap_num_slots(m));
+  m->size = 0;
+  m->shrink_limit = HASHMAP_SIZE_MAX;
+}
 
-        /* Blank out the fields */
-        memset(&m->data[index], 0, sizeof(struct hashmap_element_s));
+int hashmap_clear_and_shrink(struct hashmap_s *const m,
+                             const hashmap_size_t num_entries) {
+  const hashmap_size_t capacity =
+      hashmap_reserve_capacity_helper(m->flags, m->probe_length, num_entries);
+  hashmap_size_t new_slots;
+  struct hashmap_element_s *data;
+
+  hashmap_clear(m);
+
+#if 0 < HASHMAP_SMALL_SIZE
+  if ((m->flags & HASHMAP_FLAG_SMALL) && (HASHMAP_NULL != m->data) &&
+      (HASHMAP_SMALL_SIZE >= num_entries)) {
+    return hashmap_demote_helper(m);
+  }
+#endif
+
+  if ((HASHMAP_NULL == m->data) || (capacity >= hashmap_capacity(m))) {
+    return 0;
+  }
+
+  /* With nothing left to move, shrinking is just a smaller allocation. */
+  new_slots = capacity + m->probe_length;
+
+  data = hashmap_realloc_helper(m, m->data, hashmap_num_slots(m), new_slots);
+
+  if (HASHMAP_NULL == data) {
+    return 1;
+  }
+
+  m->data = data;
+  m->control = hashmap_table_control(data, new_slots);
+  memset(m->control, HASHMAP_CONTROL_EMPTY,
+         new_slots + HASHMAP_CONTROL_GROUP_SIZE);
+  m->log2_capacity = hashmap_log2_helper(capacity);
+
+  return 0;
+}
+
+int hashmap_put(struct hashmap_s *const m, const void *const key,
+                const hashmap_size_t len, void *const value) {
+  if ((HASHMAP_NULL == key) || (0 == len)) {
+    return 1;
+  }
+
+  return hashmap_put_key_helper(m, key, len, value);
+}
+
+int hashmap_put_batch(struct hashmap_s *const m,
+                      const void *const *const keys,
+                      const hashmap_size_t *const lens,
+                      void *const *const values,
+                      const hashmap_size_t num_keys, int *const out_results) {
+  const hashmap_size_t start_size = m->size;
+  hashmap_hash_t hashes[HASHMAP_BATCH_SIZE];
+  hashmap_size_t i, j, count, home, added, rest;
+  int hashed, result, failed = 0;
+
+  for (i = 0; i < num_keys; i += count) {
+    count = num_keys - i;
+
+    if (HASHMAP_BATCH_SIZE < count) {
+      count = HASHMAP_BATCH_SIZE;
+    }
+
+    /* Make room for these keys before fetching anything for them, as a put
+     * that grew the table would move it all. Keys that are already there take
+     * no room, so rather than reserving for every key left in the batch, only
+     * reserve for as many of them as have been new so far. An incremental
+     * grow is left to the puts so that it stays incremental. If this fails
+     * each put still grows the table as it needs to, and reports its own
+     * failure. */
+    if ((HASHMAP_NULL != m->data) &&
+        (0 == (m->flags & HASHMAP_FLAG_INCREMENTAL))) {
+      added = m->size - start_size;
+      rest = num_keys - i - count;
+      rest = (0 == i) ? 0 : ((added == i) ? rest : (rest / i) * added);
+
+      if ((HASHMAP_SIZE_MAX - m->size - count) >= rest) {
+        (void)hashmap_reserve(m, m->size + count + rest);
+      }
+    }
+
+    /* Hash every key and start loading the control bytes and the first
+     * element of its window, as the key almost always lands in one of the
+     * first few slots. Small hashmaps have nothing worth fetching ahead of
+     * time. */
+    hashed = HASHMAP_NULL != m->data;
+
+    if (hashed) {
+      for (j = 0; j < count; j++) {
+        if ((HASHMAP_NULL == keys[i + j]) || (0 == lens[i + j])) {
+          continue;
+        }
+
+        hashes[j] = hashmap_key_hash_helper(m, keys[i + j], lens[i + j]);
+        home = hashmap_hash_helper_int_helper(m, hashes[j]);
+        HASHMAP_PREFETCH(&m->control[home]);
+        HASHMAP_PREFETCH(&m->data[home]);
+      }
+    }
+
+    /* And now that everything is on its way, put the keys in. */
+    for (j = 0; j < count; j++) {
+      if ((HASHMAP_NULL == keys[i + j]) || (0 == lens[i + j])) {
+        result = 1;
+      } else if (!hashed) {
+        result = hashmap_put_key_helper(m, keys[i + j], lens[i + j],
+                                        values[i + j]);
+      } else {
+        result = hashmap_put_hashed_helper(m, keys[i + j], lens[i + j],
+                                           hashes[j], values[i + j]);
+      }
+
+      if (HASHMAP_NULL != out_results) {
+        out_results[i + j] = result;
+      }
+
+      failed |= result;
+    }
+  }
+
+  return failed;
+}
+
+void *hashmap_get(const struct hashmap_s *const m, const void *const key,
+                  const hashmap_size_t len) {
+  if ((HASHMAP_NULL == key) || (0 == len)) {
+    return HASHMAP_NULL;
+  }
+
+  return hashmap_get_key_helper(m, key, len);
+}
+
+void hashmap_get_batch(const struct hashmap_s *const m,
+                       const void *const *const keys,
+                       const hashmap_size_t *const lens,
+                       const hashmap_size_t num_keys,
+                       void **const out_values) {
+  hashmap_hash_t hashes[HASHMAP_BATCH_SIZE];
+  hashmap_size_t found[HASHMAP_BATCH_SIZE];
+  hashmap_size_t i, j, count, home;
+  hashmap_uint32_t match;
+
+  for (i = 0; i < num_keys; i += count) {
+    count = num_keys - i;
+
+    if (HASHMAP_BATCH_SIZE < count) {
+      count = HASHMAP_BATCH_SIZE;
+    }
+
+    /* Small hashmaps have nothing worth fetching ahead of time. */
+    if (HASHMAP_NULL == m->data) {
+      for (j = i; j < (i + count); j++) {
+        out_values[j] = hashmap_get(m, keys[j], lens[j]);
+      }
+
+      continue;
+    }
+
+    /* Hash every key and start loading the control bytes of its window. */
+    for (j = 0; j < count; j++) {
+      if ((HASHMAP_NULL == keys[i + j]) || (0 == lens[i + j])) {
+        continue;
+      }
+
+      hashes[j] = hashmap_key_hash_helper(m, keys[i + j], lens[i + j]);
+      HASHMAP_PREFETCH(
+          &m->control[hashmap_hash_helper_int_helper(m, hashes[j])]);
+    }
+
+    /* Start loading the first element in each window whose tag matches, which
+     * is almost always the one we are looking for. */
+    for (j = 0; j < count; j++) {
+      found[j] = HASHMAP_SIZE_MAX;
+
+      if ((HASHMAP_NULL == keys[i + j]) || (0 == lens[i + j])) {
+        continue;
+      }
+
+      home = hashmap_hash_helper_int_helper(m, hashes[j]);
+      match = hashmap_match_group(
+          m, home, hashmap_control_tag(hashes[j]),
+          (HASHMAP_CONTROL_GROUP_SIZE < m->probe_length)
+              ? HASHMAP_CONTROL_GROUP_SIZE
+              : m->probe_length);
+
+      if (0 != match) {
+        found[j] = home + hashmap_ctz(match);
+        HASHMAP_PREFETCH(&m->data[found[j]]);
+        HASHMAP_PREFETCH(HASHMAP_PTR_CAST(const hashmap_uint8_t *,
+                                          &m->data[found[j]] + 1) -
+                         1);
+      }
+    }
+
+    /* Start loading the keys of those elements that are not stored inline. */
+    for (j = 0; j < count; j++) {
+      if ((HASHMAP_SIZE_MAX != found[j]) &&
+          (HASHMAP_INLINE_KEY_SIZE < m->data[found[j]].key_len)) {
+        HASHMAP_PREFETCH(m->data[found[j]].key);
+      }
+    }
+
+    /* And now that everything is on its way, look the keys up. */
+    for (j = 0; j < count; j++) {
+      if ((HASHMAP_NULL == keys[i + j]) || (0 == lens[i + j])) {
+        out_values[i + j] = HASHMAP_NULL;
+      } else {
+        out_values[i + j] =
+            hashmap_get_hashed_helper(m, keys[i + j], lens[i + j], hashes[j]);
+      }
+    }
+  }
+}
+
+int hashmap_get_key_value(const struct hashmap_s *const m,
+                          const void *const key, const hashmap_size_t len,
+                          const void **const out_key, void **const out_value) {
+  const struct hashmap_element_s *element;
+
+  if ((HASHMAP_NULL == key) || (0 == len)) {
+    return 1;
+  }
+
+#if 0 < HASHMAP_SMALL_SIZE
+  if (HASHMAP_NULL == m->data) {
+    const hashmap_size_t index = hashmap_small_find_helper(m, key, len);
+    element = (HASHMAP_SIZE_MAX == index) ? HASHMAP_NULL
+                                          : &m->inline_data[index];
+  } else
+#endif
+  {
+    element = hashmap_get_element_helper(m, key, len,
+                                         hashmap_key_hash_helper(m, key, len));
+  }
+
+  if (HASHMAP_NULL == element) {
+    return 1;
+  }
+
+  if (HASHMAP_NULL != out_key) {
+    *out_key = element->key;
+  }
+
+  if (HASHMAP_NULL != out_value) {
+    *out_value = element->data;
+  }
+
+  return 0;
+}
+
+void **hashmap_get_or_insert(struct hashmap_s *const m, const void *const key,
+                             const hashmap_size_t len,
+                             int *const out_inserted) {
+  struct hashmap_element_s *element;
+  int inserted = 0;
+
+  if ((HASHMAP_NULL == key) || (0 == len)) {
+    return HASHMAP_NULL;
+  }
+
+  element = hashmap_entry_key_helper(m, key, len, &inserted);
+
+  if (HASHMAP_NULL == element) {
+    return HASHMAP_NULL;
+  }
+
+  if (HASHMAP_NULL != out_inserted) {
+    *out_inserted = inserted;
+  }
+
+  return &element->data;
+}
+
+int hashmap_remove(struct hashmap_s *const m, const void *const key,
+                   const hashmap_size_t len) {
+  const void *stored_key;
+
+  if ((HASHMAP_NULL == key) || (0 == len)) {
+    return 1;
+  }
+
+  return hashmap_remove_key_helper(m, key, len, &stored_key);
+}
+
+const void *hashmap_remove_and_return_key(struct hashmap_s *const m,
+                                          const void *const key,
+                                          const hashmap_size_t len) {
+  const void *stored_key;
+
+  if ((HASHMAP_NULL == key) || (0 == len)) {
+    return HASHMAP_NULL;
+  }
+
+  if (hashmap_remove_key_helper(m, key, len, &stored_key)) {
+    return HASHMAP_NULL;
+  }
+
+  return stored_key;
+}
+
+int hashmap_get_slot(const struct hashmap_s *const m, const void *const key,
+                     const hashmap_size_t len,
+                     struct hashmap_slot_s *const out_slot) {
+  hashmap_hash_t hash;
+  hashmap_size_t index;
+  hashmap_uint32_t old = 0;
+
+  if ((HASHMAP_NULL == key) || (0 == len)) {
+    return 1;
+  }
+
+#if 0 < HASHMAP_SMALL_SIZE
+  if (HASHMAP_NULL == m->data) {
+    index = hashmap_small_find_helper(m, key, len);
+  } else
+#endif
+  {
+    hash = hashmap_key_hash_helper(m, key, len);
+    index = hashmap_find_helper(m, key, len, hash);
+
+    if ((HASHMAP_SIZE_MAX == index) && (HASHMAP_NULL != m->old_data)) {
+      index = hashmap_find_old_helper(m, key, len, hash);
+      old = 1;
+    }
+  }
+
+  if (HASHMAP_SIZE_MAX == index) {
+    return 1;
+  }
+
+  out_slot->index = index;
+  out_slot->old = old;
+#if defined(HASHMAP_DEBUG)
+  out_slot->generation = m->generation;
+#else
+  out_slot->generation = 0;
+#endif
+
+  return 0;
+}
+
+void *hashmap_get_at(const struct hashmap_s *const m,
+                     const struct hashmap_slot_s *const slot) {
+  if (!hashmap_slot_valid_helper(m, slot)) {
+    return HASHMAP_NULL;
+  }
+
+#if 0 < HASHMAP_SMALL_SIZE
+  if (HASHMAP_NULL == m->data) {
+    return m->inline_data[slot->index].data;
+  }
+#endif
+
+  return slot->old ? m->old_data[slot->index].data
+                   : m->data[slot->index].data;
+}
+
+int hashmap_update_at(struct hashmap_s *const m,
+                      const struct hashmap_slot_s *const slot,
+                      void *const value) {
+  if (!hashmap_slot_valid_helper(m, slot)) {
+    return 1;
+  }
+
+#if 0 < HASHMAP_SMALL_SIZE
+  if (HASHMAP_NULL == m->data) {
+    m->inline_data[slot->index].data = value;
+  } else
+#endif
+  if (slot->old) {
+    m->old_data[slot->index].data = value;
+  } else {
+    m->data[slot->index].data = value;
+  }
+
+  return 0;
+}
+
+int hashmap_remove_at(struct hashmap_s *const m,
+                      const struct hashmap_slot_s *const slot,
+                      const void **const out_key) {
+  const void *stored_key;
+
+  if (!hashmap_slot_valid_helper(m, slot)) {
+    return 1;
+  }
+
+  /* Unlike hashmap_remove this does not move any of an incremental grow
+   * across, as that could only happen once the element is gone, and by then
+   * a failure could not be reported. */
+#if 0 < HASHMAP_SMALL_SIZE
+  if (HASHMAP_NULL == m->data) {
+    stored_key = m->inline_data[slot->index].key;
+    hashmap_small_erase_helper(m, slot->index);
+  } else
+#endif
+  if (slot->old) {
+    stored_key = m->old_data[slot->index].key;
+    hashmap_erase_old_helper(m, slot->index);
+  } else {
+    stored_key = m->data[slot->index].key;
+    hashmap_erase_helper(m, slot->index);
+    hashmap_auto_shrink_helper(m);
+  }
+
+  hashmap_invalidate_slots_helper(m);
+
+  if (HASHMAP_NULL != out_key) {
+    *out_key = stored_key;
+  }
+
+  return 0;
+}
+
+int hashmap_hash_key(const struct hashmap_s *const m, const void *const key,
+                     const hashmap_size_t len,
+                     struct hashmap_prehashed_s *const out_prehashed) {
+  out_prehashed->key = key;
+  out_prehashed->len = len;
+  out_prehashed->hash = 0;
+  out_prehashed->hasher = m->hasher;
+
+  if ((HASHMAP_NULL == key) || (0 == len)) {
+    return 1;
+  }
+
+  out_prehashed->hash = hashmap_key_hash_helper(m, key, len);
+
+  return 0;
+}
+
+int hashmap_put_prehashed(struct hashmap_s *const m,
+                          const struct hashmap_prehashed_s *const prehashed,
+                          void *const value) {
+  if ((HASHMAP_NULL == prehashed->key) || (0 == prehashed->len)) {
+    return 1;
+  }
+
+  /* Small hashmaps do not use the hash. */
+  if (HASHMAP_NULL == m->data) {
+    return hashmap_put_key_helper(m, prehashed->key, prehashed->len, value);
+  }
+
+  return hashmap_put_hashed_helper(m, prehashed->key, prehashed->len,
+                                   hashmap_prehashed_hash_helper(m, prehashed),
+                                   value);
+}
+
+void *hashmap_get_prehashed(const struct hashmap_s *const m,
+                            const struct hashmap_prehashed_s *const prehashed) {
+  if ((HASHMAP_NULL == prehashed->key) || (0 == prehashed->len)) {
+    return HASHMAP_NULL;
+  }
+
+  if (HASHMAP_NULL == m->data) {
+    return hashmap_get_key_helper(m, prehashed->key, prehashed->len);
+  }
+
+  return hashmap_get_hashed_helper(m, prehashed->key, prehashed->len,
+                                   hashmap_prehashed_hash_helper(m, prehashed));
+}
+
+int hashmap_remove_prehashed(
+    struct hashmap_s *const m,
+    const struct hashmap_prehashed_s *const prehashed) {
+  const void *stored_key;
+
+  if ((HASHMAP_NULL == prehashed->key) || (0 == prehashed->len)) {
+    return 1;
+  }
+
+  if (HASHMAP_NULL == m->data) {
+    return hashmap_remove_key_helper(m, prehashed->key, prehashed->len,
+                                     &stored_key);
+  }
+
+  return hashmap_remove_hashed_helper(
+      m, prehashed->key, prehashed->len,
+      hashmap_prehashed_hash_helper(m, prehashed), &stored_key);
+}
+
+int hashmap_put_u64(struct hashmap_s *const m, const hashmap_uint64_t key,
+                    void *const value) {
+  return hashmap_put_key_helper(m, &key, 0, value);
+}
+
+void *hashmap_get_u64(const struct hashmap_s *const m,
+                      const hashmap_uint64_t key) {
+  return hashmap_get_key_helper(m, &key, 0);
+}
+
+int hashmap_remove_u64(struct hashmap_s *const m, const hashmap_uint64_t key) {
+  const void *stored_key;
+  return hashmap_remove_key_helper(m, &key, 0, &stored_key);
+}
+
+int hashmap_iterate(const struct hashmap_s *const m,
+                    int (*f)(void *const, void *const), void *const context) {
+  hashmap_size_t i;
+
+#if 0 < HASHMAP_SMALL_SIZE
+  if (HASHMAP_NULL == m->data) {
+    for (i = 0; i < m->size; i++) {
+      if (!f(context, m->inline_data[i].data)) {
+        return 1;
+      }
+    }
+
+    return 0;
+  }
+#endif
+
+  /* Walk the control bytes rather than the elements, as they are far denser. */
+  for (i = 0; i < hashmap_num_slots(m); i++) {
+    if (HASHMAP_CONTROL_EMPTY != m->control[i]) {
+      if (!f(context, m->data[i].data)) {
+        return 1;
+      }
+    }
+  }
+
+  /* Then whatever has not been moved out of the old table yet. */
+  if (HASHMAP_NULL != m->old_data) {
+    const hashmap_size_t old_slots =
+        hashmap_old_num_slots(m);
+
+    for (i = m->migrate_index; i < old_slots; i++) {
+      if (HASHMAP_CONTROL_EMPTY != m->old_control[i]) {
+        if (!f(context, m->old_data[i].data)) {
+          return 1;
+        }
+      }
+    }
+  }
+
+  return 0;
+}
+
+int hashmap_iterate_pairs(struct hashmap_s *const m,
+                          int (*f)(void *const,
+                                   struct hashmap_element_s *const),
+                          void *const context) {
+  hashmap_size_t i = 0;
+  struct hashmap_element_s *p;
+  int r;
+
+  /* The callback can remove elements, and shrinking moves the rest. */
+  hashmap_invalidate_slots_helper(m);
+
+#if 0 < HASHMAP_SMALL_SIZE
+  if (HASHMAP_NULL == m->data) {
+    while (i < m->size) {
+      r = f(context, &m->inline_data[i]);
+      switch (r) {
+      case -1: /* remove item */
+        /* The last element is moved into this one, so visit it next. */
+        hashmap_small_erase_helper(m, i);
+        continue;
+      case 0: /* continue iterating */
+        break;
+      default: /* early exit */
+        return 1;
+      }
+
+      i++;
+    }
+
+    return 0;
+  }
+#endif
+
+  while (i < hashmap_num_slots(m)) {
+    if (HASHMAP_CONTROL_EMPTY != m->control[i]) {
+      p = &m->data[i];
+      r = f(context, p);
+      switch (r) {
+      case -1: /* remove item */
+        hashmap_erase_helper(m, i);
+
+        /* Removal can shift the next element back into this one, in which
+         * case it needs visiting before we move on. */
+        if (HASHMAP_CONTROL_EMPTY != m->control[i]) {
+          continue;
+        }
+        break;
+      case 0: /* continue iterating */
+        break;
+      default: /* early exit */
+        hashmap_auto_shrink_helper(m);
+        return 1;
+      }
+    }
+
+    i++;
+  }
+
+  if (HASHMAP_NULL != m->old_data) {
+    const hashmap_size_t old_slots =
+        hashmap_old_num_slots(m);
+
+    for (i = m->migrate_index; i < old_slots; i++) {
+      if (HASHMAP_CONTROL_EMPTY != m->old_control[i]) {
+        r = f(context, &m->old_data[i]);
+        switch (r) {
+        case -1: /* remove item */
+          hashmap_erase_old_helper(m, i);
+          break;
+        case 0: /* continue iterating */
+          break;
+        default: /* early exit */
+          hashmap_auto_shrink_helper(m);
+          return 1;
+        }
+      }
+    }
+  }
+
+  /* Shrinking moves everything, so wait until we have stopped iterating. */
+  hashmap_auto_shrink_helper(m);
+
+  return 0;
+}
+
+void hashmap_destroy(struct hashmap_s *const m) {
+  /* The control bytes live in the same allocation as the elements. */
+  hashmap_free_helper(m, m->data, hashmap_num_slots(m));
+  hashmap_free_helper(m, m->old_data,
+                      hashmap_old_num_slots(m));
+  hashmap_free_keys_helper(m, m->keys);
+  memset(m, 0, sizeof(struct hashmap_s));
+}
+
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_num_entries(const struct hashmap_s *const m) {
+  return m->size;
+}
+
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_capacity(const struct hashmap_s *const m) {
+  return HASHMAP_CAST(hashmap_size_t, 1) << m->log2_capacity;
+}
+
+#if defined(HASHMAP_64BIT)
+hashmap_hash_t hashmap_mix64_hasher(const hashmap_hash_t seed,
+                                    const void *const k,
+                                    const hashmap_size_t len) {
+  /* The multipliers from murmur3's 64-bit finalizer. A crc32 only has 32 bits
+   * to give, which is not enough to spread a table of more than 2^32 slots, so
+   * the 64-bit build mixes the key a word at a time instead. */
+  const hashmap_uint64_t m1 = HASHMAP_U64(0xff51afd7u, 0xed558ccdu);
+  const hashmap_uint64_t m2 = HASHMAP_U64(0xc4ceb9feu, 0x1a85ec53u);
+  const hashmap_uint8_t *const s = HASHMAP_PTR_CAST(const hashmap_uint8_t *, k);
+  hashmap_uint64_t h = seed ^ len;
+  hashmap_uint64_t next;
+  hashmap_size_t i = 0;
+
+  for (; (i + sizeof(hashmap_uint64_t)) <= len; i += sizeof(hashmap_uint64_t)) {
+    next = hashmap_read64_helper(s + i);
+    h = (h ^ next) * m1;
+    h ^= h >> 29;
+  }
+
+  if (i < len) {
+    next = 0;
+    memcpy(&next, &s[i], HASHMAP_CAST(size_t, len - i));
+    h = (h ^ next) * m1;
+    h ^= h >> 29;
+  }
+
+  h ^= h >> 33;
+  h *= m1;
+  h ^= h >> 33;
+  h *= m2;
+  h ^= h >> 33;
+
+  return h;
+}
+#else
+hashmap_hash_t hashmap_crc32_hasher(const hashmap_hash_t seed,
+                                    const void *const k,
+                                    const hashmap_size_t len) {
+  hashmap_uint32_t crc32val = seed;
+  const hashmap_uint8_t *const s = HASHMAP_PTR_CAST(const hashmap_uint8_t *, k);
+
+#if defined(HASHMAP_CRC32_DISPATCH)
+  /* Every thread that gets here first works out the same answer, so it does
+   * not matter which of them stores it, but the load and store of the cached
+   * answer must be atomic. MSVC makes volatile accesses on x64 atomic. */
+#if defined(_MSC_VER)
+  static volatile long supported = -1;
+  long cached = supported;
+
+  if (cached < 0) {
+    cached = hashmap_crc32_supported_helper();
+    _InterlockedExchange(&supported, cached);
+  }
+#else
+  static int supported = -1;
+  int cached = __atomic_load_n(&supported, __ATOMIC_RELAXED);
+
+  if (cached < 0) {
+    cached = hashmap_crc32_supported_helper();
+    __atomic_store_n(&supported, cached, __ATOMIC_RELAXED);
+  }
+#endif
+
+  if (cached) {
+    crc32val = hashmap_crc32_instructions_helper(crc32val, s, len);
+  } else {
+    crc32val = hashmap_crc32_table_helper(crc32val, s, len);
+  }
+#elif defined(HASHMAP_CRC32_STREAMS)
+  crc32val = hashmap_crc32_instructions_helper(crc32val, s, len);
+#elif defined(HASHMAP_X86_SSE42)
+  hashmap_size_t i = 0;
+
+  for (; (i + sizeof(hashmap_uint32_t)) < len; i += sizeof(hashmap_uint32_t)) {
+    hashmap_uint32_t next;
+    memcpy(&next, &s[i], sizeof(next));
+    crc32val = _mm_crc32_u32(crc32val, next);
+  }
+
+  for (; i < len; i++) {
+    crc32val = _mm_crc32_u8(crc32val, s[i]);
+  }
+#else
+  crc32val = hashmap_crc32_table_helper(crc32val, s, len);
+#endif
+
+  // Use the mix function from murmur3.
+  crc32val ^= len;
+
+  crc32val ^= crc32val >> 16;
+  crc32val *= 0x85ebca6b;
+  crc32val ^= crc32val >> 13;
+  crc32val *= 0xc2b2ae35;
+  crc32val ^= crc32val >> 16;
+
+  return crc32val;
+}
+#endif
+
+hashmap_hash_t hashmap_mum_hasher(const hashmap_hash_t seed,
+                                  const void *const key,
+                                  const hashmap_size_t len) {
+  /* The constants wyhash mixes with. */
+  const hashmap_uint64_t p0 = HASHMAP_U64(0xa0761d64u, 0x78bd642fu);
+  const hashmap_uint64_t p1 = HASHMAP_U64(0xe7037ed1u, 0xa0b428dbu);
+  const hashmap_uint64_t p2 = HASHMAP_U64(0x8ebc6af0u, 0x9c88c6e3u);
+  const hashmap_uint64_t p3 = HASHMAP_U64(0x589965ccu, 0x75374cc3u);
+  const hashmap_uint8_t *s = HASHMAP_PTR_CAST(const hashmap_uint8_t *, key);
+  hashmap_uint64_t h = hashmap_mum_helper(seed ^ p0, p1);
+  hashmap_uint64_t a, b;
+  hashmap_size_t i = len;
+
+  if (len <= 16) {
+    if (len >= 4) {
+      /* Two reads from each end, which overlap for anything shorter than 16
+       * bytes. */
+      const hashmap_size_t middle = (len >> 3) << 2;
+      a = (hashmap_read32_helper(s) << 32) | hashmap_read32_helper(s + middle);
+      b = (hashmap_read32_helper(s + len - 4) << 32) |
+          hashmap_read32_helper(s + len - 4 - middle);
+    } else if (len > 0) {
+      a = (HASHMAP_CAST(hashmap_uint64_t, s[0]) << 16) |
+          (HASHMAP_CAST(hashmap_uint64_t, s[len >> 1]) << 8) | s[len - 1];
+      b = 0;
+    } else {
+      a = 0;
+      b = 0;
+    }
+  } else {
+    if (i > 48) {
+      /* Mix three chains of 16 bytes side by side, as each multiply has to
+       * wait for the one before it in its chain. */
+      hashmap_uint64_t h1 = h, h2 = h;
+
+      do {
+        h = hashmap_mum_helper(hashmap_read64_helper(s) ^ p1,
+                               hashmap_read64_helper(s + 8) ^ h);
+        h1 = hashmap_mum_helper(hashmap_read64_helper(s + 16) ^ p2,
+                                hashmap_read64_helper(s + 24) ^ h1);
+        h2 = hashmap_mum_helper(hashmap_read64_helper(s + 32) ^ p3,
+                                hashmap_read64_helper(s + 40) ^ h2);
+        s += 48;
+        i -= 48;
+      } while (i > 48);
+
+      h ^= h1 ^ h2;
+    }
+
+    for (; i > 16; i -= 16) {
+      h = hashmap_mum_helper(hashmap_read64_helper(s) ^ p1,
+                             hashmap_read64_helper(s + 8) ^ h);
+      s += 16;
+    }
+
+    /* The last 16 bytes of the key, whether or not we mixed some of them
+     * already. */
+    a = hashmap_read64_helper(s + i - 16);
+    b = hashmap_read64_helper(s + i - 8);
+  }
+
+  a = hashmap_mul128_helper(a ^ p1, b ^ h, &b);
+
+  return hashmap_fold_hash_helper(hashmap_mum_helper(a ^ p0 ^ len, b ^ p1));
+}
+
+hashmap_hash_t hashmap_stripes_hasher(const hashmap_hash_t seed,
+                                      const void *const key,
+                                      const hashmap_size_t len) {
+  /* The first 64 bytes of XXH3's secret. */
+  static const hashmap_uint64_t secret[8] = {
+      HASHMAP_U64(0xbe4ba423u, 0x396cfeb8u),
+      HASHMAP_U64(0x1cad21f7u, 0x2c81017cu),
+      HASHMAP_U64(0xdb979083u, 0xe96dd4deu),
+      HASHMAP_U64(0x1f67b3b7u, 0xa4a44072u),
+      HASHMAP_U64(0x78e5c0ccu, 0x4ee679cbu),
+      HASHMAP_U64(0x2172ffccu, 0x7dd05a82u),
+      HASHMAP_U64(0x8e2443f7u, 0x744608b8u),
+      HASHMAP_U64(0x4c263a81u, 0xe69035e0u)};
+  const hashmap_uint64_t prime1 = HASHMAP_U64(0x9e3779b1u, 0x85ebca87u);
+  const hashmap_uint64_t prime2 = HASHMAP_U64(0xc2b2ae3du, 0x27d4eb4fu);
+  const hashmap_uint64_t prime3 = HASHMAP_U64(0x165667b1u, 0x9e3779f9u);
+  const hashmap_uint64_t prime4 = HASHMAP_U64(0x85ebca77u, 0xc2b2ae63u);
+  const hashmap_uint64_t prime5 = HASHMAP_U64(0x27d4eb2fu, 0x165667c5u);
+  const hashmap_uint8_t *const s =
+      HASHMAP_PTR_CAST(const hashmap_uint8_t *, key);
+  hashmap_uint64_t acc[8];
+  hashmap_uint64_t h;
+  hashmap_size_t i = 0;
+
+  /* Setting up and merging the lanes costs more than it saves on a short
+   * key. */
+  if (len <= 256) {
+    return hashmap_mum_hasher(seed, key, len);
+  }
+
+  acc[0] = HASHMAP_CAST(hashmap_uint64_t, 0xc2b2ae3du) + seed;
+  acc[1] = prime1 + seed;
+  acc[2] = prime2 + seed;
+  acc[3] = prime3 + seed;
+  acc[4] = prime4 + seed;
+  acc[5] = HASHMAP_CAST(hashmap_uint64_t, 0x85ebca77u) + seed;
+  acc[6] = prime5 + seed;
+  acc[7] = HASHMAP_CAST(hashmap_uint64_t, 0x9e3779b1u) + seed;
+
+  for (; (len - i) > 1024; i += 1024) {
+    hashmap_stripes_helper(acc, s + i, secret, 16);
+    hashmap_scramble_helper(acc, secret);
+  }
+
+  hashmap_stripes_helper(acc, s + i, secret, (len - i - 1) / 64);
+
+  /* The last stripe ends on the last byte of the key, and overlaps the stripe
+   * before it unless the key is a multiple of 64 bytes long. */
+  hashmap_stripes_helper(acc, s + len - 64, secret, 1);
+
+  h = HASHMAP_CAST(hashmap_uint64_t, len) * prime1;
+  h += hashmap_mum_helper(acc[0] ^ secret[1], acc[1] ^ secret[2]);
+  h += hashmap_mum_helper(acc[2] ^ secret[3], acc[3] ^ secret[4]);
+  h += hashmap_mum_helper(acc[4] ^ secret[5], acc[5] ^ secret[6]);
+  h += hashmap_mum_helper(acc[6] ^ secret[7], acc[7] ^ secret[0]);
+
+  h ^= h >> 37;
+  h *= prime3;
+  h ^= h >> 32;
+
+  return hashmap_fold_hash_helper(h);
+}
+
+int hashmap_memcmp_comparer(const void *const a, const hashmap_size_t a_len,
+                            const void *const b, const hashmap_size_t b_len) {
+  return (a_len == b_len) && (0 == memcmp(a, b, a_len));
+}
+
+void *hashmap_default_allocate(void *const context, const size_t size) {
+  (void)context;
+  return malloc(size);
+}
+
+void *hashmap_default_reallocate(void *const context, void *const pointer,
+                                 const size_t old_size, const size_t new_size) {
+  (void)context;
+  (void)old_size;
+  return realloc(pointer, new_size);
+}
+
+void hashmap_default_deallocate(void *const context, void *const pointer,
+                                const size_t size) {
+  (void)context;
+  (void)size;
+  free(pointer);
+}
+
+HASHMAP_ALWAYS_INLINE struct hashmap_element_s *
+hashmap_alloc_helper(const struct hashmap_s *const m,
+                     const hashmap_size_t slots) {
+  const size_t size = hashmap_table_size(slots);
+  hashmap_uint8_t *data;
+  size_t offset;
+
+  /* Mapped tables always start on a page. */
+  if (hashmap_mapped_helper(m, size)) {
+    return HASHMAP_PTR_CAST(struct hashmap_element_s *,
+                            hashmap_map_helper(m->flags, size));
+  }
+
+  /* Allocate a cache line more than we need so that the table can start on
+   * a cache line, whatever alignment the allocator gives us. */
+  data = HASHMAP_PTR_CAST(
+      hashmap_uint8_t *,
+      m->allocator.allocate(m->allocator.context,
+                            size + HASHMAP_CACHE_LINE_SIZE));
+
+  if (HASHMAP_NULL == data) {
+    return HASHMAP_NULL;
+  }
+
+  offset = hashmap_align_helper(data);
+  data[offset - 1] = HASHMAP_CAST(hashmap_uint8_t, offset);
+  return HASHMAP_PTR_CAST(struct hashmap_element_s *,
+                          HASHMAP_PTR_CAST(void *, data + offset));
+}
+
+HASHMAP_ALWAYS_INLINE struct hashmap_element_s *
+hashmap_realloc_helper(const struct hashmap_s *const m,
+                       struct hashmap_element_s *const data,
+                       const hashmap_size_t old_slots,
+                       const hashmap_size_t new_slots) {
+  const size_t old_size = hashmap_table_size(old_slots);
+  const size_t new_size = hashmap_table_size(new_slots);
+  struct hashmap_element_s *new_data;
+
+  if ((HASHMAP_NULL != m->allocator.reallocate) &&
+      !hashmap_mapped_helper(m, old_size) &&
+      !hashmap_mapped_helper(m, new_size)) {
+    hashmap_uint8_t *const aligned = HASHMAP_PTR_CAST(hashmap_uint8_t *, data);
+    const size_t old_offset = aligned[-1];
+    hashmap_uint8_t *const reallocated = HASHMAP_PTR_CAST(
+        hashmap_uint8_t *,
+        m->allocator.reallocate(m->allocator.context, aligned - old_offset,
+                                old_size + HASHMAP_CACHE_LINE_SIZE,
+                                new_size + HASHMAP_CACHE_LINE_SIZE));
+    size_t new_offset;
+
+    if (HASHMAP_NULL == reallocated) {
+      return HASHMAP_NULL;
+    }
+
+    /* The reallocated memory may not be aligned like it was before, in which
+     * case the table has to be moved to where the alignment now is. */
+    new_offset = hashmap_align_helper(reallocated);
+
+    if (new_offset != old_offset) {
+      memmove(reallocated + new_offset, reallocated + old_offset,
+              (old_size < new_size) ? old_size : new_size);
+      reallocated[new_offset - 1] = HASHMAP_CAST(hashmap_uint8_t, new_offset);
+    }
+
+    return HASHMAP_PTR_CAST(struct hashmap_element_s *,
+                            HASHMAP_PTR_CAST(void *, reallocated + new_offset));
+  }
+
+  /* Without a reallocate, or when either table is mapped, we have to copy the
+   * table ourselves. */
+  new_data = hashmap_alloc_helper(m, new_slots);
+
+  if (HASHMAP_NULL != new_data) {
+    memcpy(new_data, data, (old_size < new_size) ? old_size : new_size);
+    hashmap_free_helper(m, data, old_slots);
+  }
+
+  return new_data;
+}
+
+HASHMAP_ALWAYS_INLINE int hashmap_mapped_helper(const struct hashmap_s *const m,
+                                                const size_t size) {
+#if defined(HASHMAP_MMAP)
+  /* Whether a table is mapped only depends on its size, so that freeing it
+   * does not have to remember how it was allocated. */
+  return (0 != (m->flags & (HASHMAP_FLAG_HUGE_PAGES | HASHMAP_FLAG_PREFAULT))) &&
+         (HASHMAP_HUGE_PAGE_SIZE <= size);
+#else
+  (void)m;
+  (void)size;
+  return 0;
+#endif
+}
+
+HASHMAP_ALWAYS_INLINE void *hashmap_map_helper(const hashmap_uint32_t flags,
+                                               const size_t size) {
+#if defined(HASHMAP_MMAP)
+  const size_t length = (size + HASHMAP_HUGE_PAGE_SIZE - 1) &
+                        ~HASHMAP_CAST(size_t, HASHMAP_HUGE_PAGE_SIZE - 1);
+  const int protection = PROT_READ | PROT_WRITE;
+  const int map_flags = MAP_PRIVATE | HASHMAP_MAP_ANONYMOUS;
+  const int prefault = 0 != (flags & HASHMAP_FLAG_PREFAULT);
+#if defined(MAP_POPULATE)
+  const int populate = prefault ? MAP_POPULATE : 0;
+#else
+  const int populate = 0;
+#endif
+#if defined(MADV_HUGEPAGE)
+  const int advise = 0 != (flags & HASHMAP_FLAG_HUGE_PAGES);
+#else
+  const int advise = 0;
+#endif
+  void *pointer;
+  size_t i;
+
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+  /* Explicit huge pages only exist if the system has set some aside, so fall
+   * back to transparent huge pages when there are none to be had. The size is
+   * given, as the length has to be a multiple of the page size, both here and
+   * when it is unmapped. */
+  if (flags & HASHMAP_FLAG_HUGE_PAGES) {
+    const int huge_size = HASHMAP_CAST(
+        int, hashmap_log2_helper(HASHMAP_HUGE_PAGE_SIZE) << MAP_HUGE_SHIFT);
+    pointer = mmap(HASHMAP_NULL, length, protection,
+                   map_flags | MAP_HUGETLB | huge_size | populate, -1, 0);
+
+    if (MAP_FAILED != pointer) {
+      return pointer;
+    }
+  }
+#endif
+
+  /* Populating the mapping before it is marked for huge pages would fault it
+   * in as small pages, so in that case it is prefaulted once marked. */
+  pointer = mmap(HASHMAP_NULL, length, protection,
+                 map_flags | (advise ? 0 : populate), -1, 0);
+
+  if (MAP_FAILED == pointer) {
+    return HASHMAP_NULL;
+  }
+
+#if defined(MADV_HUGEPAGE)
+  if (advise) {
+    /* If transparent huge pages are turned off the small pages still work. */
+    (void)madvise(pointer, length, MADV_HUGEPAGE);
+  }
+#endif
+
+  if (prefault && (advise || (0 == populate))) {
+    for (i = 0; i < length; i += 4096) {
+      HASHMAP_PTR_CAST(volatile hashmap_uint8_t *, pointer)[i] = 0;
+    }
+  }
+
+  return pointer;
+#else
+  (void)flags;
+  (void)size;
+  return HASHMAP_NULL;
+#endif
+}
+
+HASHMAP_ALWAYS_INLINE void hashmap_unmap_helper(void *const pointer,
+                                                const size_t size) {
+#if defined(HASHMAP_MMAP)
+  const size_t length = (size + HASHMAP_HUGE_PAGE_SIZE - 1) &
+                        ~HASHMAP_CAST(size_t, HASHMAP_HUGE_PAGE_SIZE - 1);
+  (void)munmap(pointer, length);
+#else
+  (void)pointer;
+  (void)size;
+#endif
+}
+
+HASHMAP_ALWAYS_INLINE void
+hashmap_free_helper(const struct hashmap_s *const m,
+                    struct hashmap_element_s *const data,
+                    const hashmap_size_t slots) {
+  const size_t size = hashmap_table_size(slots);
+
+  if (HASHMAP_NULL == data) {
+    return;
+  }
+
+  if (hashmap_mapped_helper(m, size)) {
+    hashmap_unmap_helper(data, size);
+  } else {
+    hashmap_uint8_t *const aligned = HASHMAP_PTR_CAST(hashmap_uint8_t *, data);
+    m->allocator.deallocate(m->allocator.context, aligned - aligned[-1],
+                            size + HASHMAP_CACHE_LINE_SIZE);
+  }
+}
+
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_num_slots(const struct hashmap_s *const m) {
+  /* The probe window of the last slot runs past the capacity rather than
+   * wrapping around. */
+  return hashmap_capacity(m) + m->probe_length;
+}
+
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_old_num_slots(const struct hashmap_s *const m) {
+  return (HASHMAP_CAST(hashmap_size_t, 1) << m->old_log2_capacity) +
+         m->probe_length;
+}
+
+HASHMAP_ALWAYS_INLINE size_t hashmap_table_size(const hashmap_size_t slots) {
+  /* The elements and their control bytes share one allocation. The control
+   * bytes are padded by a group so that matching a group never reads past the
+   * end of the allocation. */
+  return hashmap_elements_size(slots) + slots + HASHMAP_CONTROL_GROUP_SIZE;
+}
+
+HASHMAP_ALWAYS_INLINE size_t
+hashmap_elements_size(const hashmap_size_t slots) {
+  /* Pad the elements out to a whole number of cache lines, so that the
+   * control bytes start on a cache line too. */
+  return ((slots * sizeof(struct hashmap_element_s)) +
+          (HASHMAP_CACHE_LINE_SIZE - 1)) &
+         ~HASHMAP_CAST(size_t, HASHMAP_CACHE_LINE_SIZE - 1);
+}
+
+HASHMAP_ALWAYS_INLINE hashmap_uint8_t *
+hashmap_table_control(struct hashmap_element_s *const data,
+                      const hashmap_size_t slots) {
+  return HASHMAP_PTR_CAST(hashmap_uint8_t *, data) +
+         hashmap_elements_size(slots);
+}
+
+HASHMAP_ALWAYS_INLINE size_t hashmap_align_helper(const void *const pointer) {
+  /* How far to move an allocation forward so that it starts on a cache line.
+   * It is always moved by at least one byte, which is where we record how far
+   * it was moved so that the allocation can be found again. */
+  return HASHMAP_CACHE_LINE_SIZE -
+         (HASHMAP_PTR_CAST(size_t, pointer) & (HASHMAP_CACHE_LINE_SIZE - 1));
+}
+
+HASHMAP_ALWAYS_INLINE hashmap_uint32_t
+hashmap_load_factor_helper(const hashmap_uint32_t flags,
+                           const hashmap_uint32_t probe_length) {
+  /* How full (in 256ths) a large hashmap gets before the first probe window
+   * overflows. Short windows overflow much sooner, and Robin Hood insertion
+   * lets the hashmap fill further. */
+  static const hashmap_uint32_t load_factors[2][4] = {{8, 24, 64, 112},
+                                                      {16, 72, 152, 192}};
+  const hashmap_uint32_t robin_hood = (flags & HASHMAP_FLAG_ROBIN_HOOD) ? 1 : 0;
+
+  if (8 > probe_length) {
+    return load_factors[robin_hood][0];
+  } else if (16 > probe_length) {
+    return load_factors[robin_hood][1];
+  } else if (32 > probe_length) {
+    return load_factors[robin_hood][2];
+  }
+
+  return load_factors[robin_hood][3];
+}
+
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_max_entries_helper(const hashmap_uint32_t load_factor,
+                           const hashmap_size_t capacity) {
+  /* Scale down the capacity before the load factor so that it cannot
+   * overflow, which is exact for every capacity past 256. */
+  return (capacity < 256) ? ((capacity * load_factor) >> 8)
+                          : ((capacity >> 8) * load_factor);
+}
+
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_reserve_capacity_helper(const hashmap_uint32_t flags,
+                                const hashmap_uint32_t probe_length,
+                                const hashmap_size_t num_entries) {
+  const hashmap_uint32_t load_factor =
+      hashmap_load_factor_helper(flags, probe_length);
+  hashmap_size_t capacity = 2;
+
+  while ((capacity <
+          (HASHMAP_CAST(hashmap_size_t, 1) << HASHMAP_MAX_LOG2_CAPACITY)) &&
+         (hashmap_max_entries_helper(load_factor, capacity) < num_entries)) {
+    capacity <<= 1;
+  }
+
+  return capacity;
+}
+
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_hash_helper_int_helper(const struct hashmap_s *const m,
+                               const hashmap_hash_t hash) {
+#if defined(HASHMAP_64BIT)
+  const hashmap_uint64_t golden = HASHMAP_U64(0x9e3779b9u, 0x7f4a7c15u);
+  return (hash * golden) >> (64u - m->log2_capacity);
+#else
+  return (hash * 2654435769u) >> (32u - m->log2_capacity);
+#endif
+}
+
+HASHMAP_ALWAYS_INLINE hashmap_uint8_t
+hashmap_control_tag(const hashmap_hash_t hash) {
+  /* The index uses the top bits of the hash, so the tag uses the bottom. */
+  return HASHMAP_CAST(hashmap_uint8_t, hash & 0x7fu);
+}
+
+HASHMAP_ALWAYS_INLINE hashmap_uint32_t
+hashmap_match_control(const hashmap_uint8_t *const control,
+                      const hashmap_uint8_t tag) {
+#if defined(HASHMAP_X86_SSE2)
+  const __m128i group = _mm_loadu_si128(HASHMAP_PTR_CAST(
+      const __m128i *, HASHMAP_PTR_CAST(const void *, control)));
+  const __m128i match = _mm_cmpeq_epi8(group, _mm_set1_epi8(HASHMAP_CAST(
+                                                  char, tag)));
+  return HASHMAP_CAST(hashmap_uint32_t, _mm_movemask_epi8(match));
+#elif defined(HASHMAP_ARM_NEON)
+  /* NEON has no movemask, so weight each matching lane by its bit within each
+   * half of the group and sum the halves. */
+  const uint8x8_t half_bits =
+      vcreate_u8(HASHMAP_U64(0x80402010u, 0x08040201u));
+  const uint8x16_t match = vandq_u8(vceqq_u8(vld1q_u8(control), vdupq_n_u8(tag)),
+                                    vcombine_u8(half_bits, half_bits));
+  return HASHMAP_CAST(hashmap_uint32_t, vaddv_u8(vget_low_u8(match))) |
+         (HASHMAP_CAST(hashmap_uint32_t, vaddv_u8(vget_high_u8(match))) << 8);
+#else
+  hashmap_uint32_t i;
+  hashmap_uint32_t result = 0;
+
+  for (i = 0; i < HASHMAP_CONTROL_GROUP_SIZE; i++) {
+    if (tag == control[i]) {
+      result |= 1u << i;
+    }
+  }
+
+  return result;
+#endif
+}
+
+HASHMAP_ALWAYS_INLINE hashmap_uint32_t
+hashmap_match_half_control(const hashmap_uint8_t *const control,
+                           const hashmap_uint8_t tag) {
+#if defined(HASHMAP_X86_SSE2)
+  const __m128i group = _mm_loadl_epi64(HASHMAP_PTR_CAST(
+      const __m128i *, HASHMAP_PTR_CAST(const void *, control)));
+  const __m128i match = _mm_cmpeq_epi8(group, _mm_set1_epi8(HASHMAP_CAST(
+                                                  char, tag)));
+  return HASHMAP_CAST(hashmap_uint32_t, _mm_movemask_epi8(match)) & 0xffu;
+#elif defined(HASHMAP_ARM_NEON)
+  const uint8x8_t half_bits =
+      vcreate_u8(HASHMAP_U64(0x80402010u, 0x08040201u));
+  const uint8x8_t match =
+      vand_u8(vceq_u8(vld1_u8(control), vdup_n_u8(tag)), half_bits);
+  return HASHMAP_CAST(hashmap_uint32_t, vaddv_u8(match));
+#else
+  hashmap_uint32_t i;
+  hashmap_uint32_t result = 0;
+
+  for (i = 0; i < (HASHMAP_CONTROL_GROUP_SIZE / 2); i++) {
+    if (tag == control[i]) {
+      result |= 1u << i;
+    }
+  }
+
+  return result;
+#endif
+}
+
+HASHMAP_ALWAYS_INLINE hashmap_uint32_t
+hashmap_match_group(const struct hashmap_s *const m,
+                    const hashmap_size_t index, const hashmap_uint8_t tag,
+                    const hashmap_uint32_t length) {
+  hashmap_uint32_t match;
+
+  /* A window that fits in half a group only loads half a group, which is half
+   * as likely to straddle two cache lines. */
+  if (length <= (HASHMAP_CONTROL_GROUP_SIZE / 2)) {
+    match = hashmap_match_half_control(&m->control[index], tag);
+  } else {
+    match = hashmap_match_control(&m->control[index], tag);
+  }
+
+  /* Ignore anything in the group past the end of the probe window. */
+  if (length < HASHMAP_CONTROL_GROUP_SIZE) {
+    return match & ((1u << length) - 1u);
+  }
+
+  return match;
+}
+
+HASHMAP_ALWAYS_INLINE hashmap_size_t hashmap_find_group_helper(
+    const struct hashmap_s *const m, const void *const key,
+    const hashmap_size_t len, const hashmap_hash_t hash,
+    const hashmap_size_t index, const hashmap_uint32_t length) {
+  hashmap_uint32_t match =
+      hashmap_match_group(m, index, hashmap_control_tag(hash), length);
+
+  /* A Robin Hood run never has a free element in it, so the key cannot be
+   * anywhere past the first free element in the window. */
+  if (m->flags & HASHMAP_FLAG_ROBIN_HOOD) {
+    const hashmap_uint32_t empty =
+        hashmap_match_group(m, index, HASHMAP_CONTROL_EMPTY, length);
+    match &= (empty & (0u - empty)) - 1u;
+  }
+
+  /* Only elements whose control byte matches our tag can possibly hold the
+   * key, so the comparer is not called on anything else in the window. */
+  while (0 != match) {
+    const hashmap_size_t i = index + hashmap_ctz(match);
+
+    /* Check the full hash before paying for a call to the comparer. */
+    if ((hash == m->data[i].hash) &&
+        hashmap_match_key_helper(m, &m->data[i], key, len)) {
+      return i;
+    }
+
+    match &= match - 1;
+  }
+
+  return HASHMAP_SIZE_MAX;
+}
+
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_find_helper(const struct hashmap_s *const m, const void *const key,
+                    const hashmap_size_t len, const hashmap_hash_t hash) {
+  const hashmap_size_t curr = hashmap_hash_helper_int_helper(m, hash);
+  hashmap_uint32_t group;
+  hashmap_size_t index;
+
+  /* Specialize the common probe lengths so that they are a single group
+   * match with a constant mask. */
+  switch (m->probe_length) {
+  case 8:
+    return hashmap_find_group_helper(m, key, len, hash, curr, 8);
+  case 16:
+    return hashmap_find_group_helper(m, key, len, hash, curr, 16);
+  default:
+    break;
+  }
+
+  for (group = 0; group < m->probe_length;
+       group += HASHMAP_CONTROL_GROUP_SIZE) {
+    index = hashmap_find_group_helper(m, key, len, hash, curr + group,
+                                      m->probe_length - group);
+
+    if (HASHMAP_SIZE_MAX != index) {
+      return index;
+    }
+
+    if ((m->flags & HASHMAP_FLAG_ROBIN_HOOD) &&
+        (0 != hashmap_match_group(m, curr + group, HASHMAP_CONTROL_EMPTY,
+                                  m->probe_length - group))) {
+      break;
+    }
+  }
+
+  return HASHMAP_SIZE_MAX;
+}
+
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_probe_distance(const struct hashmap_s *const m,
+                       const hashmap_size_t index) {
+  return index - hashmap_hash_helper_int_helper(m, m->data[index].hash);
+}
+
+HASHMAP_ALWAYS_INLINE int
+hashmap_robin_hood_helper(struct hashmap_s *const m,
+                          const hashmap_hash_t hash,
+                          hashmap_size_t *const out_index) {
+  const hashmap_size_t curr = hashmap_hash_helper_int_helper(m, hash);
+  const hashmap_size_t end = hashmap_num_slots(m);
+  hashmap_size_t i, last;
+
+  /* Find either a free element, or the first element that is closer to its
+   * ideal slot than we would be if we skipped past it. */
+  for (i = 0; i < m->probe_length; i++) {
+    if (HASHMAP_CONTROL_EMPTY == m->control[curr + i]) {
+      *out_index = curr + i;
+      return 1;
+    }
+
+    if (hashmap_probe_distance(m, curr + i) < i) {
+      break;
+    }
+  }
+
+  if (m->probe_length == i) {
+    return 0;
+  }
+
+  /* Everything from there up to the next free element moves along by one, so
+   * none of those elements can already be at the end of their window. */
+  for (last = curr + i; HASHMAP_CONTROL_EMPTY != m->control[last]; last++) {
+    if ((last + 1 == end) ||
+        (hashmap_probe_distance(m, last) + 1 == m->probe_length)) {
+      break;
+    }
+  }
+
+  if (HASHMAP_CONTROL_EMPTY == m->control[last]) {
+    memmove(&m->data[curr + i + 1], &m->data[curr + i],
+            (last - curr - i) * sizeof(struct hashmap_element_s));
+    memmove(&m->control[curr + i + 1], &m->control[curr + i], last - curr - i);
+
+    memset(&m->data[curr + i], 0, sizeof(struct hashmap_element_s));
+    m->control[curr + i] = HASHMAP_CONTROL_EMPTY;
+
+    *out_index = curr + i;
+    return 1;
+  }
+
+  /* Taking some other free element in our window would leave a gap before us
+   * that lookups stop at, so the hashmap has to grow instead. */
+  return 0;
+}
+
+HASHMAP_ALWAYS_INLINE int
+hashmap_insert_helper(struct hashmap_s *const m, const hashmap_hash_t hash,
+                      hashmap_size_t *const out_index) {
+  hashmap_size_t curr;
+  hashmap_uint32_t group;
+
+  if (m->flags & HASHMAP_FLAG_ROBIN_HOOD) {
+    return hashmap_robin_hood_helper(m, hash, out_index);
+  }
+
+  /* Find the best index */
+  curr = hashmap_hash_helper_int_helper(m, hash);
+
+  for (group = 0; group < m->probe_length;
+       group += HASHMAP_CONTROL_GROUP_SIZE) {
+    const hashmap_uint32_t empty = hashmap_match_group(
+        m, curr + group, HASHMAP_CONTROL_EMPTY, m->probe_length - group);
+
+    if (0 != empty) {
+      *out_index = curr + group + hashmap_ctz(empty);
+      return 1;
+    }
+  }
+
+  // Couldn't find a free element in the linear probe.
+  return 0;
+}
+
+HASHMAP_ALWAYS_INLINE int
+hashmap_hash_helper(struct hashmap_s *const m, const hashmap_hash_t hash,
+                    hashmap_size_t *const out_index) {
+  /* If full, return immediately */
+  if (hashmap_num_entries(m) == hashmap_capacity(m)) {
+    return 0;
+  }
+
+  return hashmap_insert_helper(m, hash, out_index);
+}
+
+HASHMAP_ALWAYS_INLINE struct hashmap_element_s *
+hashmap_entry_helper(struct hashmap_s *const m, const void *const key,
+                     const hashmap_size_t len, const hashmap_hash_t hash,
+                     int *const out_inserted) {
+  hashmap_size_t index;
+  const void *stored_key = key;
+
+  /* If the key is already in the hashmap we reuse its element. This has to be
+   * checked before whether the hashmap is full, as growing it would move the
+   * key out of the table that the caller looks for it in next. */
+  index = hashmap_find_helper(m, key, len, hash);
+
+  if (HASHMAP_SIZE_MAX != index) {
+    *out_inserted = 0;
+    return &m->data[index];
+  }
+
+  /* Find a place to put our value. */
+  while (!hashmap_hash_helper(m, hash, &index)) {
+    if (hashmap_rehash_helper(m)) {
+      return HASHMAP_NULL;
+    }
+  }
+
+  if (hashmap_copies_key_helper(m, len)) {
+    stored_key = hashmap_copy_key_helper(m, key, len);
+
+    /* A Robin Hood insert has already shifted the rest of the run along to
+     * make room, and a free element left in the middle of the run would hide
+     * everything after it, so shift it back. */
+    if (HASHMAP_NULL == stored_key) {
+      hashmap_free_element_helper(m, index);
+      return HASHMAP_NULL;
+    }
+  }
+
+  /* Set the data. */
+  m->data[index].data = HASHMAP_NULL;
+  hashmap_set_key_helper(&m->data[index], stored_key, len);
+
+  /* The element was not already in use, so set that it is being used and bump
+   * our size. */
+  m->data[index].in_use = 1;
+  m->data[index].hash = hash;
+  m->control[index] = hashmap_control_tag(hash);
+  m->size++;
+
+  *out_inserted = 1;
+  return &m->data[index];
+}
+
+/* Blanks out an element, and in a Robin Hood hashmap closes up the gap it
+ * leaves in its run. It does not change the size. */
+HASHMAP_ALWAYS_INLINE void
+hashmap_free_element_helper(struct hashmap_s *const m, hashmap_size_t index) {
+  if (m->flags & HASHMAP_FLAG_ROBIN_HOOD) {
+    const hashmap_size_t end = hashmap_num_slots(m);
+    hashmap_size_t last;
+
+    /* Shift the elements that follow back towards their ideal slot, which
+     * leaves the element to blank out at the end of the run. */
+    for (last = index + 1; (last < end) &&
+                           (HASHMAP_CONTROL_EMPTY != m->control[last]) &&
+                           (0 != hashmap_probe_distance(m, last));
+         last++) {
+    }
+
+    memmove(&m->data[index], &m->data[index + 1],
+            (last - index - 1) * sizeof(struct hashmap_element_s));
+    memmove(&m->control[index], &m->control[index + 1], last - index - 1);
+
+    index = last - 1;
+  }
+
+  /* Blank out the fields including in_use */
+  memset(&m->data[index], 0, sizeof(struct hashmap_element_s));
+  m->control[index] = HASHMAP_CONTROL_EMPTY;
+}
+
+HASHMAP_ALWAYS_INLINE void hashmap_erase_helper(struct hashmap_s *const m,
+                                                const hashmap_size_t index) {
+  hashmap_free_element_helper(m, index);
+
+  /* Reduce the size */
+  m->size--;
+}
+
+/*
+ * Grows the hashmap in place to the given capacity. The index comes from the
+ * top bits of the hash, so when doubling an element whose ideal slot was i
+ * moves to 2i or 2i + 1 (and likewise for bigger factors). Walking the old
+ * elements down from the end of the table means the new windows of all but
+ * the first few elements only hold elements that have already been moved.
+ */
+HASHMAP_WEAK int hashmap_grow_helper(struct hashmap_s *const m,
+                                     const hashmap_uint32_t log2_capacity) {
+  const hashmap_size_t old_slots = hashmap_num_slots(m);
+  hashmap_size_t new_slots, i, index, home, end;
+  struct hashmap_element_s *data;
+  struct hashmap_element_s element;
+  hashmap_uint32_t next_log2;
+  int failed = 0;
+
+  /* Moving elements in place can leave gaps in a Robin Hood run while the
+   * elements near the start of the table are sorted out, so those hashmaps
+   * are rebuilt into a fresh table instead. */
+  if (m->flags & HASHMAP_FLAG_ROBIN_HOOD) {
+    for (next_log2 = log2_capacity; next_log2 <= HASHMAP_MAX_LOG2_CAPACITY;
+         next_log2++) {
+      if (hashmap_rebuild_helper(m, next_log2)) {
+        return 1;
+      }
+
+      if (next_log2 == m->log2_capacity) {
+        m->shrink_limit = HASHMAP_SIZE_MAX;
+        return 0;
+      }
+    }
+
+    return 1;
+  }
+
+  if (HASHMAP_MAX_LOG2_CAPACITY < log2_capacity) {
+    return 1;
+  }
+
+  new_slots = (HASHMAP_CAST(hashmap_size_t, 1) << log2_capacity) +
+              m->probe_length;
+
+  data = hashmap_realloc_helper(m, m->data, old_slots, new_slots);
+
+  if (HASHMAP_NULL == data) {
+    return 1;
+  }
+
+  /* Move the control bytes to the end of the grown table first, as the
+   * elements we are about to clear overlap where they used to be. */
+  m->data = data;
+  m->control = hashmap_table_control(data, new_slots);
+  memmove(m->control, hashmap_table_control(data, old_slots), old_slots);
+  memset(m->control + old_slots, HASHMAP_CONTROL_EMPTY,
+         (new_slots - old_slots) + HASHMAP_CONTROL_GROUP_SIZE);
+  memset(data + old_slots, 0,
+         (new_slots - old_slots) * sizeof(struct hashmap_element_s));
+
+  m->log2_capacity = log2_capacity;
+
+  /* A shrink that failed at the old capacity says nothing about the new one. */
+  m->shrink_limit = HASHMAP_SIZE_MAX;
+
+  for (i = old_slots; 0 < i; i--) {
+    index = i - 1;
+
+    if (HASHMAP_CONTROL_EMPTY == m->control[index]) {
+      continue;
+    }
+
+    element = data[index];
+    memset(&data[index], 0, sizeof(struct hashmap_element_s));
+    m->control[index] = HASHMAP_CONTROL_EMPTY;
+
+    /* If the new window is full the element stays where it is for now, and
+     * is reinserted below once everything else has moved. */
+    if (!hashmap_insert_helper(m, element.hash, &index)) {
+      failed = 1;
+    }
+
+    data[index] = element;
+    m->control[index] = hashmap_control_tag(element.hash);
+  }
+
+  /* Near the start of the table new windows can overlap elements that had
+   * not moved yet, so anything there (or anything that could not move) may
+   * now be outside its window. */
+  end = failed ? new_slots : (2 * m->probe_length);
+
+  for (index = 0; (index < end) && (index < new_slots); index++) {
+    if (HASHMAP_CONTROL_EMPTY == m->control[index]) {
+      continue;
+    }
+
+    home = hashmap_hash_helper_int_helper(m, m->data[index].hash);
+
+    if ((home <= index) && ((index - home) < m->probe_length)) {
+      continue;
+    }
+
+    element = m->data[index];
+    memset(&m->data[index], 0, sizeof(struct hashmap_element_s));
+    m->control[index] = HASHMAP_CONTROL_EMPTY;
+
+    i = m->log2_capacity;
+
+    while (!hashmap_insert_helper(m, element.hash, &home)) {
+      if (hashmap_grow_helper(m, m->log2_capacity + 1)) {
+        m->data[index] = element;
+        m->control[index] = hashmap_control_tag(element.hash);
+        return 1;
+      }
+    }
+
+    m->data[home] = element;
+    m->control[home] = hashmap_control_tag(element.hash);
+
+    /* If reinserting had to grow the hashmap again, that rebuilt everything. */
+    if (i != m->log2_capacity) {
+      return 0;
+    }
+  }
+
+  return 0;
+}
+
+HASHMAP_ALWAYS_INLINE void
+hashmap_old_table_helper(const struct hashmap_s *const m,
+                         struct hashmap_s *const out_old) {
+  /* Describe the old table as a hashmap of its own, so that the same find
+   * helpers can be used on it. */
+  *out_old = *m;
+  out_old->log2_capacity = m->old_log2_capacity;
+  out_old->data = m->old_data;
+  out_old->control = m->old_control;
+
+  /* Elements are taken out of the old table without shifting the rest of
+   * their run back, so lookups there cannot stop at a free element. */
+  out_old->flags &= ~HASHMAP_FLAG_ROBIN_HOOD;
+}
+
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_find_old_helper(const struct hashmap_s *const m, const void *const key,
+                        const hashmap_size_t len,
+                        const hashmap_hash_t hash) {
+  struct hashmap_s old;
+  hashmap_old_table_helper(m, &old);
+  return hashmap_find_helper(&old, key, len, hash);
+}
+
+HASHMAP_ALWAYS_INLINE void
+hashmap_erase_old_helper(struct hashmap_s *const m,
+                         const hashmap_size_t index) {
+  /* Nothing is ever inserted into the old table, so there is no need to keep
+   * its Robin Hood ordering intact. */
+  memset(&m->old_data[index], 0, sizeof(struct hashmap_element_s));
+  m->old_control[index] = HASHMAP_CONTROL_EMPTY;
+  m->size--;
+}
+
+/*
+ * Moves up to count slots of the old table across into the new one, and frees
+ * the old table once it is empty.
+ */
+HASHMAP_WEAK int hashmap_migrate_helper(struct hashmap_s *const m,
+                                        hashmap_size_t count) {
+  const hashmap_size_t old_slots =
+      hashmap_old_num_slots(m);
+  hashmap_size_t index;
+
+  for (; (0 < count) && (m->migrate_index < old_slots);
+       count--, m->migrate_index++) {
+    const struct hashmap_element_s *const element =
+        &m->old_data[m->migrate_index];
+
+    if (HASHMAP_CONTROL_EMPTY == m->old_control[m->migrate_index]) {
+      continue;
+    }
+
+    /* The new table can run out of room in a window just like any other. */
+    while (!hashmap_insert_helper(m, element->hash, &index)) {
+      if (hashmap_grow_helper(m, m->log2_capacity + 1)) {
+        return 1;
+      }
+    }
+
+    m->data[index] = *element;
+    m->control[index] = hashmap_control_tag(element->hash);
+    m->old_control[m->migrate_index] = HASHMAP_CONTROL_EMPTY;
+  }
+
+  if (m->migrate_index == old_slots) {
+    hashmap_free_helper(m, m->old_data, old_slots);
+    m->old_data = HASHMAP_NULL;
+    m->old_control = HASHMAP_NULL;
+    m->old_log2_capacity = 0;
+    m->migrate_index = 0;
+    hashmap_compact_keys_helper(m);
+  }
+
+  return 0;
+}
+
+/*
+ * Starts an incremental grow by swapping in an empty table of twice the
+ * capacity. The elements are moved across by hashmap_migrate_helper.
+ */
+HASHMAP_WEAK int hashmap_migrate_start_helper(struct hashmap_s *const m) {
+  const hashmap_size_t new_capacity = hashmap_capacity(m) * 2;
+  hashmap_size_t new_slots;
+  struct hashmap_element_s *data;
+
+  if (0 == new_capacity) {
+    return 1;
+  }
+
+  new_slots = new_capacity + m->probe_length;
+
+  data = hashmap_alloc_helper(m, new_slots);
+
+  if (HASHMAP_NULL == data) {
+    return 1;
+  }
+
+  m->old_data = m->data;
+  m->old_control = m->control;
+  m->old_log2_capacity = m->log2_capacity;
+  m->migrate_index = 0;
+
+  m->data = data;
+  m->control = hashmap_table_control(data, new_slots);
+  memset(m->control, HASHMAP_CONTROL_EMPTY,
+         new_slots + HASHMAP_CONTROL_GROUP_SIZE);
+  m->log2_capacity++;
+  m->shrink_limit = HASHMAP_SIZE_MAX;
+
+  return 0;
+}
+
+HASHMAP_WEAK int hashmap_rehash_helper(struct hashmap_s *const m) {
+  /* If the new table fills up before the old one is empty, finish moving
+   * everything across first and let the caller try again. */
+  if (HASHMAP_NULL != m->old_data) {
+    return hashmap_migrate_helper(m, HASHMAP_SIZE_MAX);
+  }
+
+  if (m->flags & HASHMAP_FLAG_INCREMENTAL) {
+    return hashmap_migrate_start_helper(m);
+  }
+
+  if (hashmap_grow_helper(m, m->log2_capacity + 1)) {
+    return 1;
+  }
+
+  hashmap_compact_keys_helper(m);
+
+  return 0;
+}
+
+/*
+ * Rebuilds the hashmap into a fresh table of the given capacity. If the
+ * elements do not all fit in their windows the hashmap is left as it was.
+ */
+HASHMAP_WEAK int
+hashmap_rebuild_helper(struct hashmap_s *const m,
+                       const hashmap_uint32_t log2_capacity) {
+  const hashmap_size_t old_slots = hashmap_num_slots(m);
+  const hashmap_size_t new_slots =
+      (HASHMAP_CAST(hashmap_size_t, 1) << log2_capacity) + m->probe_length;
+  struct hashmap_element_s *const old_data = m->data;
+  hashmap_uint8_t *const old_control = m->control;
+  const hashmap_uint32_t old_log2_capacity = m->log2_capacity;
+  hashmap_size_t i, index;
+
+  m->data = hashmap_alloc_helper(m, new_slots);
+
+  if (HASHMAP_NULL == m->data) {
+    m->data = old_data;
+    return 1;
+  }
+
+  /* The new table is swapped into the hashmap itself, rather than into a
+   * copy of it, as a copy would include any inline elements too. */
+  m->control = hashmap_table_control(m->data, new_slots);
+  memset(m->control, HASHMAP_CONTROL_EMPTY,
+         new_slots + HASHMAP_CONTROL_GROUP_SIZE);
+  m->log2_capacity = log2_capacity;
+
+  for (i = 0; i < old_slots; i++) {
+    if (HASHMAP_CONTROL_EMPTY == old_control[i]) {
+      continue;
+    }
+
+    if (!hashmap_insert_helper(m, old_data[i].hash, &index)) {
+      hashmap_free_helper(m, m->data, new_slots);
+      m->data = old_data;
+      m->control = old_control;
+      m->log2_capacity = old_log2_capacity;
+      return 0;
+    }
+
+    m->data[index] = old_data[i];
+    m->control[index] = old_control[i];
+  }
+
+  hashmap_free_helper(m, old_data, old_slots);
+
+  return 0;
+}
+
+/*
+ * Shrinks the hashmap to the smallest capacity from the one given that all of
+ * its elements fit in.
+ */
+HASHMAP_WEAK int hashmap_shrink_to_helper(struct hashmap_s *const m,
+                                          const hashmap_size_t capacity) {
+  hashmap_uint32_t log2_capacity;
+
+#if 0 < HASHMAP_SMALL_SIZE
+  if ((m->flags & HASHMAP_FLAG_SMALL) && (HASHMAP_SMALL_SIZE >= m->size)) {
+    return hashmap_demote_helper(m);
+  }
+#endif
+
+  for (log2_capacity = hashmap_log2_helper(capacity);
+       log2_capacity < m->log2_capacity; log2_capacity++) {
+    if (hashmap_rebuild_helper(m, log2_capacity)) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+HASHMAP_ALWAYS_INLINE void
+hashmap_auto_shrink_helper(struct hashmap_s *const m) {
+  const hashmap_size_t capacity = hashmap_capacity(m) >> 2;
+
+  if ((0 == (m->flags & HASHMAP_FLAG_AUTO_SHRINK)) ||
+      (HASHMAP_NULL == m->data) || (HASHMAP_NULL != m->old_data)) {
+    return;
+  }
+
+  if ((m->size >= m->shrink_limit) ||
+      (m->size >= hashmap_max_entries_helper(
+                      hashmap_load_factor_helper(m->flags, m->probe_length),
+                      capacity))) {
+    return;
+  }
+
+  /* Shrinking is only ever an optimization, so a failure to allocate the
+   * smaller table is not reported. */
+  (void)hashmap_shrink_to_helper(
+      m, 2 * hashmap_reserve_capacity_helper(m->flags, m->probe_length,
+                                             m->size));
+
+  /* If the elements did not fit in anything smaller, do not try again until
+   * the hashmap has halved in size, otherwise every remove would pay for a
+   * failed shrink. */
+  m->shrink_limit =
+      (hashmap_capacity(m) < (capacity << 2)) ? HASHMAP_SIZE_MAX : m->size / 2;
+}
+
+#if 0 < HASHMAP_SMALL_SIZE
+
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_small_find_helper(const struct hashmap_s *const m,
+                          const void *const key, const hashmap_size_t len) {
+  hashmap_size_t i;
+
+  /* With this few elements comparing every key is cheaper than hashing. */
+  for (i = 0; i < m->size; i++) {
+    if (hashmap_match_key_helper(m, &m->inline_data[i], key, len)) {
+      return i;
+    }
+  }
+
+  return HASHMAP_SIZE_MAX;
+}
+
+HASHMAP_ALWAYS_INLINE void
+hashmap_small_erase_helper(struct hashmap_s *const m,
+                           const hashmap_size_t index) {
+  /* The inline elements are kept packed by moving the last one into the
+   * hole. */
+  m->size--;
+  m->inline_data[index] = m->inline_data[m->size];
+  memset(&m->inline_data[m->size], 0, sizeof(struct hashmap_element_s));
+}
+
+/*
+ * Moves the inline elements into a newly allocated table of the given
+ * capacity. On failure the hashmap is left as it was.
+ */
+HASHMAP_WEAK int hashmap_promote_helper(struct hashmap_s *const m,
+                                        const hashmap_size_t capacity) {
+  const hashmap_size_t num_slots = capacity + m->probe_length;
+  struct hashmap_element_s *const data = hashmap_alloc_helper(m, num_slots);
+  hashmap_size_t i, index;
+  hashmap_hash_t hash;
+
+  if (HASHMAP_NULL == data) {
+    return 1;
+  }
+
+  m->data = data;
+  m->control = hashmap_table_control(data, num_slots);
+  memset(m->control, HASHMAP_CONTROL_EMPTY,
+         num_slots + HASHMAP_CONTROL_GROUP_SIZE);
+  m->log2_capacity = hashmap_log2_helper(capacity);
+
+  for (i = 0; i < m->size; i++) {
+    hash = hashmap_key_hash_helper(m, hashmap_element_key(&m->inline_data[i]),
+                                   m->inline_data[i].key_len);
+
+    while (!hashmap_insert_helper(m, hash, &index)) {
+      if (hashmap_grow_helper(m, m->log2_capacity + 1)) {
+        hashmap_free_helper(m, m->data, hashmap_num_slots(m));
+        m->data = HASHMAP_NULL;
+        m->control = HASHMAP_NULL;
+        m->log2_capacity = hashmap_log2_helper(HASHMAP_SMALL_SIZE);
+        return 1;
+      }
+    }
+
+    m->data[index] = m->inline_data[i];
+    m->data[index].hash = hash;
+    m->control[index] = hashmap_control_tag(hash);
+  }
+
+  return 0;
+}
+
+/*
+ * Moves the elements of a hashmap that has HASHMAP_SMALL_SIZE or fewer back
+ * inline and frees its table.
+ */
+HASHMAP_WEAK int hashmap_demote_helper(struct hashmap_s *const m) {
+  hashmap_size_t i, size = 0;
+
+  for (i = 0; i < hashmap_num_slots(m); i++) {
+    if (HASHMAP_CONTROL_EMPTY != m->control[i]) {
+      m->inline_data[size++] = m->data[i];
+    }
+  }
+
+  hashmap_free_helper(m, m->data, hashmap_num_slots(m));
+  m->data = HASHMAP_NULL;
+  m->control = HASHMAP_NULL;
+  m->log2_capacity = hashmap_log2_helper(HASHMAP_SMALL_SIZE);
+
+  return 0;
+}
+#endif
+
+/*
+ * The key helpers do the work of both the string slice and the integer key
+ * functions. An integer key is passed as a pointer to a hashmap_uint64_t with
+ * a len of 0, which a string slice can never have.
+ */
+HASHMAP_ALWAYS_INLINE struct hashmap_element_s *
+hashmap_entry_key_helper(struct hashmap_s *const m, const void *const key,
+                         const hashmap_size_t len, int *const out_inserted) {
+  hashmap_invalidate_slots_helper(m);
+
+#if 0 < HASHMAP_SMALL_SIZE
+  if (HASHMAP_NULL == m->data) {
+    hashmap_size_t index = hashmap_small_find_helper(m, key, len);
+
+    if (HASHMAP_SIZE_MAX != index) {
+      *out_inserted = 0;
+      return &m->inline_data[index];
+    }
+
+    if (HASHMAP_SMALL_SIZE > m->size) {
+      const void *stored_key = key;
+
+      if (hashmap_copies_key_helper(m, len)) {
+        stored_key = hashmap_copy_key_helper(m, key, len);
+
+        if (HASHMAP_NULL == stored_key) {
+          return HASHMAP_NULL;
+        }
+      }
+
+      index = m->size++;
+      m->inline_data[index].in_use = 1;
+      m->inline_data[index].hash = 0;
+      m->inline_data[index].data = HASHMAP_NULL;
+      hashmap_set_key_helper(&m->inline_data[index], stored_key, len);
+      *out_inserted = 1;
+      return &m->inline_data[index];
+    }
+
+    /* Out of inline elements, so move them into a table. */
+    if (hashmap_promote_helper(
+            m, hashmap_reserve_capacity_helper(m->flags, m->probe_length,
+                                               2 * HASHMAP_SMALL_SIZE))) {
+      return HASHMAP_NULL;
+    }
+  }
+#endif
+
+  return hashmap_entry_hashed_helper(
+      m, key, len, hashmap_key_hash_helper(m, key, len), out_inserted);
+}
+
+HASHMAP_ALWAYS_INLINE struct hashmap_element_s *
+hashmap_entry_hashed_helper(struct hashmap_s *const m, const void *const key,
+                            const hashmap_size_t len,
+                            const hashmap_hash_t hash,
+                            int *const out_inserted) {
+  hashmap_size_t index;
+
+  hashmap_invalidate_slots_helper(m);
+
+  if (HASHMAP_NULL != m->old_data) {
+    if (hashmap_migrate_helper(m, HASHMAP_MIGRATE_STEP)) {
+      return HASHMAP_NULL;
+    }
+  }
+
+  /* A key that has not been moved across yet is left where it is. */
+  if (HASHMAP_NULL != m->old_data) {
+    index = hashmap_find_old_helper(m, key, len, hash);
+
+    if (HASHMAP_SIZE_MAX != index) {
+      *out_inserted = 0;
+      return &m->old_data[index];
+    }
+  }
+
+  return hashmap_entry_helper(m, key, len, hash, out_inserted);
+}
+
+/*
+ * Puts are entries that then have their value set, and for an element that
+ * was already there, their key too.
+ */
+HASHMAP_ALWAYS_INLINE int
+hashmap_put_entry_helper(const struct hashmap_s *const m,
+                         struct hashmap_element_s *const element,
+                         const int inserted, const void *const key,
+                         const hashmap_size_t len, void *const value) {
+  if (HASHMAP_NULL == element) {
+    return 1;
+  }
+
+  if (inserted) {
+    element->data = value;
+  } else {
+    hashmap_update_helper(m, element, key, len, value);
+  }
+
+  return 0;
+}
+
+HASHMAP_ALWAYS_INLINE int
+hashmap_put_key_helper(struct hashmap_s *const m, const void *const key,
+                       const hashmap_size_t len, void *const value) {
+  int inserted = 0;
+  struct hashmap_element_s *const element =
+      hashmap_entry_key_helper(m, key, len, &inserted);
+
+  return hashmap_put_entry_helper(m, element, inserted, key, len, value);
+}
+
+HASHMAP_ALWAYS_INLINE int
+hashmap_put_hashed_helper(struct hashmap_s *const m, const void *const key,
+                          const hashmap_size_t len, const hashmap_hash_t hash,
+                          void *const value) {
+  int inserted = 0;
+  struct hashmap_element_s *const element =
+      hashmap_entry_hashed_helper(m, key, len, hash, &inserted);
+
+  return hashmap_put_entry_helper(m, element, inserted, key, len, value);
+}
+
+HASHMAP_ALWAYS_INLINE void *
+hashmap_get_key_helper(const struct hashmap_s *const m, const void *const key,
+                       const hashmap_size_t len) {
+#if 0 < HASHMAP_SMALL_SIZE
+  if (HASHMAP_NULL == m->data) {
+    const hashmap_size_t index = hashmap_small_find_helper(m, key, len);
+    return (HASHMAP_SIZE_MAX == index) ? HASHMAP_NULL
+                                       : m->inline_data[index].data;
+  }
+#endif
+
+  return hashmap_get_hashed_helper(m, key, len,
+                                   hashmap_key_hash_helper(m, key, len));
+}
+
+HASHMAP_ALWAYS_INLINE void *
+hashmap_get_hashed_helper(const struct hashmap_s *const m,
+                          const void *const key, const hashmap_size_t len,
+                          const hashmap_hash_t hash) {
+  const struct hashmap_element_s *const element =
+      hashmap_get_element_helper(m, key, len, hash);
+
+  return (HASHMAP_NULL == element) ? HASHMAP_NULL : element->data;
+}
+
+HASHMAP_ALWAYS_INLINE struct hashmap_element_s *
+hashmap_get_element_helper(const struct hashmap_s *const m,
+                           const void *const key, const hashmap_size_t len,
+                           const hashmap_hash_t hash) {
+  hashmap_size_t index = hashmap_find_helper(m, key, len, hash);
+
+  if (HASHMAP_SIZE_MAX != index) {
+    return &m->data[index];
+  }
+
+  if (HASHMAP_NULL != m->old_data) {
+    index = hashmap_find_old_helper(m, key, len, hash);
+
+    if (HASHMAP_SIZE_MAX != index) {
+      return &m->old_data[index];
+    }
+  }
+
+  /* Not found */
+  return HASHMAP_NULL;
+}
+
+HASHMAP_ALWAYS_INLINE int
+hashmap_remove_key_helper(struct hashmap_s *const m, const void *const key,
+                          const hashmap_size_t len,
+                          const void **const out_key) {
+  hashmap_invalidate_slots_helper(m);
+
+#if 0 < HASHMAP_SMALL_SIZE
+  if (HASHMAP_NULL == m->data) {
+    const hashmap_size_t index = hashmap_small_find_helper(m, key, len);
+
+    if (HASHMAP_SIZE_MAX == index) {
+      return 1;
+    }
+
+    *out_key = m->inline_data[index].key;
+    hashmap_small_erase_helper(m, index);
+    return 0;
+  }
+#endif
+
+  return hashmap_remove_hashed_helper(
+      m, key, len, hashmap_key_hash_helper(m, key, len), out_key);
+}
+
+HASHMAP_ALWAYS_INLINE int
+hashmap_remove_hashed_helper(struct hashmap_s *const m, const void *const key,
+                             const hashmap_size_t len,
+                             const hashmap_hash_t hash,
+                             const void **const out_key) {
+  hashmap_size_t index;
+
+  hashmap_invalidate_slots_helper(m);
+
+  if (HASHMAP_NULL != m->old_data) {
+    /* Keep migrating on removes too, so that a hashmap which has stopped
+     * growing still gets rid of its old table. */
+    if (hashmap_migrate_helper(m, HASHMAP_MIGRATE_STEP)) {
+      return 1;
+    }
+  }
+
+  index = hashmap_find_helper(m, key, len, hash);
+
+  if (HASHMAP_SIZE_MAX != index) {
+    *out_key = m->data[index].key;
+    hashmap_erase_helper(m, index);
+    hashmap_auto_shrink_helper(m);
+    return 0;
+  }
+
+  if (HASHMAP_NULL != m->old_data) {
+    index = hashmap_find_old_helper(m, key, len, hash);
+
+    if (HASHMAP_SIZE_MAX != index) {
+      *out_key = m->old_data[index].key;
+      hashmap_erase_old_helper(m, index);
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+HASHMAP_ALWAYS_INLINE void
+hashmap_invalidate_slots_helper(struct hashmap_s *const m) {
+#if defined(HASHMAP_DEBUG)
+  m->generation++;
+#else
+  (void)m;
+#endif
+}
 
-        /* Reduce the size */
-        m->size--;
+HASHMAP_ALWAYS_INLINE int
+hashmap_slot_valid_helper(const struct hashmap_s *const m,
+                          const struct hashmap_slot_s *const slot) {
+#if defined(HASHMAP_DEBUG)
+  return slot->generation == m->generation;
+#else
+  (void)m;
+  (void)slot;
+  return 1;
+#endif
+}
 
-        return stored_key;
-      }
-    }
+HASHMAP_ALWAYS_INLINE hashmap_hash_t hashmap_prehashed_hash_helper(
+    const struct hashmap_s *const m,
+    const struct hashmap_prehashed_s *const prehashed) {
+  /* A hash from some other hasher would send us to the wrong window. */
+  if (prehashed->hasher != m->hasher) {
+    return hashmap_key_hash_helper(m, prehashed->key, prehashed->len);
   }
 
-  return HASHMAP_NULL;
+  return prehashed->hash;
 }
 
-int hashmap_iterate(const struct hashmap_s *const m,
-                    int (*f)(void *const, void *const), void *const context) {
-  hashmap_uint32_t i;
+HASHMAP_ALWAYS_INLINE void
+hashmap_update_helper(const struct hashmap_s *const m,
+                      struct hashmap_element_s *const element,
+                      const void *const key, const hashmap_size_t len,
+                      void *const value) {
+  element->data = value;
 
-  for (i = 0; i < (hashmap_capacity(m) + HASHMAP_LINEAR_PROBE_LENGTH); i++) {
-    if (m->data[i].in_use) {
-      if (!f(context, m->data[i].data)) {
-        return 1;
-      }
+  /* A copied key already has a copy that matches, so keep that one. */
+  if (!hashmap_copies_key_helper(m, len)) {
+    hashmap_set_key_helper(element, key, len);
+  }
+}
+
+HASHMAP_ALWAYS_INLINE hashmap_hash_t
+hashmap_key_hash_helper(const struct hashmap_s *const m, const void *const key,
+                        const hashmap_size_t len) {
+  if (0 == len) {
+    /* Fold the top half in so that keys which only differ there still
+     * differ after the multiply, then fold the well mixed top half of the
+     * product back down into the low bits that the control tag is taken
+     * from. */
+    const hashmap_uint64_t multiplier = HASHMAP_U64(0xd6e8feb8u, 0x6659fd93u);
+    hashmap_uint64_t x;
+    memcpy(&x, key, sizeof(hashmap_uint64_t));
+    x ^= x >> 32;
+    x *= multiplier;
+    x ^= x >> 32;
+    return HASHMAP_CAST(hashmap_hash_t, x);
+  }
+
+  return m->hasher(~0u, key, len);
+}
+
+HASHMAP_ALWAYS_INLINE int
+hashmap_match_key_helper(const struct hashmap_s *const m,
+                         const struct hashmap_element_s *const element,
+                         const void *const key, const hashmap_size_t len) {
+  if (0 == len) {
+    hashmap_uint64_t stored, wanted;
+
+    if (0 != element->key_len) {
+      return 0;
     }
+
+    memcpy(&stored, hashmap_element_key(element), sizeof(hashmap_uint64_t));
+    memcpy(&wanted, key, sizeof(hashmap_uint64_t));
+    return stored == wanted;
   }
 
-  return 0;
+  return m->comparer(hashmap_element_key(element), element->key_len, key, len);
 }
 
-int hashmap_iterate_pairs(struct hashmap_s *const m,
-                          int (*f)(void *const,
-                                   struct hashmap_element_s *const),
-                          void *const context) {
-  hashmap_uint32_t i;
-  struct hashmap_element_s *p;
-  int r;
+HASHMAP_ALWAYS_INLINE const void *
+hashmap_element_key(const struct hashmap_element_s *const element) {
+#if 0 < HASHMAP_INLINE_KEY_SIZE
+  if (HASHMAP_INLINE_KEY_SIZE >= element->key_len) {
+    return element->inline_key;
+  }
+#endif
 
-  for (i = 0; i < (hashmap_capacity(m) + HASHMAP_LINEAR_PROBE_LENGTH); i++) {
-    p = &m->data[i];
-    if (p->in_use) {
-      r = f(context, p);
-      switch (r) {
-      case -1: /* remove item */
-        memset(p, 0, sizeof(struct hashmap_element_s));
-        m->size--;
-        break;
-      case 0: /* continue iterating */
-        break;
-      default: /* early exit */
-        return 1;
-      }
+  return element->key;
+}
+
+HASHMAP_ALWAYS_INLINE void
+hashmap_set_key_helper(struct hashmap_element_s *const element,
+                       const void *const key, const hashmap_size_t len) {
+  /* The key pointer is kept even for inline keys, as it is what
+   * hashmap_iterate_pairs and hashmap_remove_and_return_key hand back. */
+  element->key = key;
+  element->key_len = len;
+
+#if 0 < HASHMAP_INLINE_KEY_SIZE
+  if (HASHMAP_INLINE_KEY_SIZE >= len) {
+    memcpy(element->inline_key, key, hashmap_key_size_helper(len));
+  }
+#endif
+}
+
+/* The number of bytes a key takes up, where an integer key has a len of 0. */
+HASHMAP_ALWAYS_INLINE hashmap_size_t
+hashmap_key_size_helper(const hashmap_size_t len) {
+  return (0 == len) ? sizeof(hashmap_uint64_t) : len;
+}
+
+/* Integer keys are always copied, as the caller only passed them by value. */
+HASHMAP_ALWAYS_INLINE int
+hashmap_copies_key_helper(const struct hashmap_s *const m,
+                          const hashmap_size_t len) {
+  return (0 == len) || (0 != (m->flags & HASHMAP_FLAG_OWN_KEYS));
+}
+
+/*
+ * Copies a key into the key blocks of the hashmap, allocating a new block if
+ * the current one is full. Returns NULL if the allocation failed.
+ */
+HASHMAP_WEAK const void *hashmap_copy_key_helper(struct hashmap_s *const m,
+                                                 const void *const key,
+                                                 const hashmap_size_t len) {
+  const hashmap_size_t key_size = hashmap_key_size_helper(len);
+  struct hashmap_key_block_s *block = m->keys;
+  hashmap_uint8_t *copy;
+
+  if ((HASHMAP_NULL == block) ||
+      (key_size > (block->size - block->used))) {
+    size_t size = HASHMAP_KEY_BLOCK_SIZE;
+
+    if ((HASHMAP_NULL != block) && (size < (block->size * 2))) {
+      size = block->size * 2;
+    }
+
+    if (size < len) {
+      size = len;
     }
+
+    block = HASHMAP_PTR_CAST(
+        struct hashmap_key_block_s *,
+        m->allocator.allocate(m->allocator.context,
+                              sizeof(struct hashmap_key_block_s) + size));
+
+    if (HASHMAP_NULL == block) {
+      return HASHMAP_NULL;
+    }
+
+    block->next = m->keys;
+    block->size = size;
+    block->used = 0;
+    m->keys = block;
   }
-  return 0;
+
+  copy = HASHMAP_PTR_CAST(hashmap_uint8_t *, block + 1) + block->used;
+  memcpy(copy, key, key_size);
+  block->used += key_size;
+
+  return copy;
 }
 
-void hashmap_destroy(struct hashmap_s *const m) {
-  free(m->data);
-  memset(m, 0, sizeof(struct hashmap_s));
+/* Frees a key block and every block after it. */
+HASHMAP_WEAK void hashmap_free_keys_helper(struct hashmap_s *const m,
+                                           struct hashmap_key_block_s *block) {
+  while (HASHMAP_NULL != block) {
+    struct hashmap_key_block_s *const next = block->next;
+    m->allocator.deallocate(m->allocator.context, block,
+                            sizeof(struct hashmap_key_block_s) + block->size);
+    block = next;
+  }
 }
 
-HASHMAP_ALWAYS_INLINE hashmap_uint32_t
-hashmap_num_entries(const struct hashmap_s *const m) {
-  return m->size;
+/*
+ * Copies the keys of every element into a single new key block, in the order
+ * the elements are in the table, and frees the old blocks. This drops the
+ * copies of keys that have since been removed. If the allocation fails the
+ * keys are left where they were.
+ */
+HASHMAP_WEAK void hashmap_compact_keys_helper(struct hashmap_s *const m) {
+  struct hashmap_key_block_s *block;
+  hashmap_uint8_t *copy;
+  size_t total = 0, size;
+  hashmap_size_t i;
+
+  /* Keys are not moved while an incremental grow has elements in two tables,
+   * they are moved when it finishes instead. */
+  if ((HASHMAP_NULL == m->keys) || (HASHMAP_NULL == m->data) ||
+      (HASHMAP_NULL != m->old_data)) {
+    return;
+  }
+
+  for (i = 0; i < hashmap_num_slots(m); i++) {
+    if ((HASHMAP_CONTROL_EMPTY != m->control[i]) &&
+        hashmap_copies_key_helper(m, m->data[i].key_len)) {
+      total += hashmap_key_size_helper(m->data[i].key_len);
+    }
+  }
+
+  if ((HASHMAP_NULL == m->keys->next) && (total == m->keys->used)) {
+    return;
+  }
+
+  /* Leave room for the hashmap to keep growing before the next resize. */
+  size = total + total / 2;
+
+  if (size < HASHMAP_KEY_BLOCK_SIZE) {
+    size = HASHMAP_KEY_BLOCK_SIZE;
+  }
+
+  block = HASHMAP_PTR_CAST(
+      struct hashmap_key_block_s *,
+      m->allocator.allocate(m->allocator.context,
+                            sizeof(struct hashmap_key_block_s) + size));
+
+  if (HASHMAP_NULL == block) {
+    return;
+  }
+
+  block->next = HASHMAP_NULL;
+  block->size = size;
+  block->used = total;
+
+  copy = HASHMAP_PTR_CAST(hashmap_uint8_t *, block + 1);
+
+  for (i = 0; i < hashmap_num_slots(m); i++) {
+    if ((HASHMAP_CONTROL_EMPTY != m->control[i]) &&
+        hashmap_copies_key_helper(m, m->data[i].key_len)) {
+      const hashmap_size_t key_size =
+          hashmap_key_size_helper(m->data[i].key_len);
+      memcpy(copy, m->data[i].key, key_size);
+      m->data[i].key = copy;
+      copy += key_size;
+    }
+  }
+
+  hashmap_free_keys_helper(m, m->keys);
+  m->keys = block;
 }
 
 HASHMAP_ALWAYS_INLINE hashmap_uint32_t
-hashmap_capacity(const struct hashmap_s *const m) {
-  return 1u << m->log2_capacity;
+hashmap_log2_helper(const hashmap_size_t x) {
+#if defined(HASHMAP_64BIT)
+  if (0 != (x >> 32)) {
+    return 63u - hashmap_clz(HASHMAP_CAST(hashmap_uint32_t, x >> 32));
+  }
+
+  return 31u - hashmap_clz(HASHMAP_CAST(hashmap_uint32_t, x));
+#else
+  return 31u - hashmap_clz(x);
+#endif
 }
 
-hashmap_uint32_t hashmap_crc32_hasher(const hashmap_uint32_t seed,
-                                      const void *const k,
-                                      const hashmap_uint32_t len) {
-  hashmap_uint32_t i = 0;
-  hashmap_uint32_t crc32val = seed;
-  const hashmap_uint8_t *const s = HASHMAP_PTR_CAST(const hashmap_uint8_t *, k);
+HASHMAP_ALWAYS_INLINE hashmap_uint32_t hashmap_clz(const hashmap_uint32_t x) {
+#if defined(_MSC_VER)
+  unsigned long result;
+  _BitScanReverse(&result, x);
+  return 31u - HASHMAP_CAST(hashmap_uint32_t, result);
+#elif defined(__TINYC__)
+  union {
+    double d;
+    hashmap_uint64_t u;
+  } u;
+  u.d = HASHMAP_CAST(double, x) + 0.5;
+  return 1054u - HASHMAP_CAST(hashmap_uint32_t, u.u >> 52);
+#else
+  return HASHMAP_CAST(hashmap_uint32_t, __builtin_clz(x));
+#endif
+}
 
-#if defined(HASHMAP_X86_SSE42)
-  for (; (i + sizeof(hashmap_uint32_t)) < len; i += sizeof(hashmap_uint32_t)) {
-    hashmap_uint32_t next;
-    memcpy(&next, &s[i], sizeof(next));
-    crc32val = _mm_crc32_u32(crc32val, next);
+HASHMAP_ALWAYS_INLINE hashmap_uint32_t hashmap_ctz(const hashmap_uint32_t x) {
+#if defined(_MSC_VER)
+  unsigned long result;
+  _BitScanForward(&result, x);
+  return HASHMAP_CAST(hashmap_uint32_t, result);
+#elif defined(__TINYC__)
+  hashmap_uint32_t result = 0;
+  while (0 == ((x >> result) & 1u)) {
+    result++;
   }
+  return result;
+#else
+  return HASHMAP_CAST(hashmap_uint32_t, __builtin_ctz(x));
+#endif
+}
 
-  for (; i < len; i++) {
-    crc32val = _mm_crc32_u8(crc32val, s[i]);
+#if defined(HASHMAP_CRC32_STREAMS)
+HASHMAP_ALWAYS_INLINE HASHMAP_CRC32_TARGET hashmap_uint32_t
+hashmap_crc32_u64_helper(const hashmap_uint32_t crc,
+                         const hashmap_uint8_t *const s) {
+  hashmap_uint64_t next;
+  memcpy(&next, s, sizeof(next));
+
+#if defined(HASHMAP_X86_CRC32_U64)
+  return HASHMAP_CAST(hashmap_uint32_t, _mm_crc32_u64(crc, next));
+#else
+  /* AArch64 has both a crc32 and a crc32c instruction. The stream shifts are
+   * for the crc32c polynomial, as are SSE 4.2 and the table, so it has to be
+   * the crc32c one here (and below) for every machine to give the same hash. */
+  return __crc32cd(crc, next);
+#endif
+}
+
+/*
+ * Gives the crc of whatever the given crc was of followed by n zero bytes,
+ * where shift is x^(8n-33) mod P. The crc instruction reduces the carry-less
+ * product of the two (which is one bit short of being multiplied by x^33) for
+ * us.
+ */
+HASHMAP_ALWAYS_INLINE HASHMAP_CRC32_TARGET hashmap_uint32_t
+hashmap_crc32_shift_helper(const hashmap_uint32_t crc,
+                           const hashmap_uint32_t shift) {
+  hashmap_uint64_t product = 0;
+  hashmap_uint8_t bytes[sizeof(hashmap_uint64_t)];
+
+#if defined(HASHMAP_X86_PCLMUL)
+  product = HASHMAP_CAST(
+      hashmap_uint64_t,
+      _mm_cvtsi128_si64(_mm_clmulepi64_si128(
+          _mm_cvtsi32_si128(HASHMAP_CAST(int, crc)),
+          _mm_cvtsi32_si128(HASHMAP_CAST(int, shift)), 0)));
+#else
+  /* Multiply by each nibble of the shift in turn, with a table of what the
+   * crc gives for each possible nibble. */
+  hashmap_uint64_t table[16];
+  hashmap_uint32_t i;
+
+  table[0] = 0;
+  table[1] = crc;
+
+  for (i = 2; i < 16; i += 2) {
+    table[i] = table[i / 2] << 1;
+    table[i + 1] = table[i] ^ crc;
   }
-#elif defined(HASHMAP_ARM_CRC32)
-  for (; (i + sizeof(hashmap_uint64_t)) < len; i += sizeof(hashmap_uint64_t)) {
-    hashmap_uint64_t next;
-    memcpy(&next, &s[i], sizeof(next));
-    crc32val = __crc32d(crc32val, next);
+
+  for (i = 0; i < 32; i += 4) {
+    product ^= table[(shift >> i) & 0xfu] << i;
+  }
+#endif
+
+  memcpy(bytes, &product, sizeof(bytes));
+  return hashmap_crc32_u64_helper(0, bytes);
+}
+
+/*
+ * Gives the crc of 3 blocks of bytes. The blocks are hashed side by side, as
+ * each crc instruction has to wait for the one before it but the CPU can work
+ * on one from each block at once, and the crcs of the first two are then
+ * shifted past the blocks after them to get the crc of all of them.
+ */
+HASHMAP_ALWAYS_INLINE HASHMAP_CRC32_TARGET hashmap_uint32_t
+hashmap_crc32_streams_helper(hashmap_uint32_t crc,
+                             const hashmap_uint8_t *const s,
+                             const hashmap_size_t block,
+                             const hashmap_uint32_t shift_one,
+                             const hashmap_uint32_t shift_two) {
+  hashmap_uint32_t crc_one = 0, crc_two = 0;
+  hashmap_size_t i;
+
+  for (i = 0; i < block; i += sizeof(hashmap_uint64_t)) {
+    crc = hashmap_crc32_u64_helper(crc, &s[i]);
+    crc_one = hashmap_crc32_u64_helper(crc_one, &s[block + i]);
+    crc_two = hashmap_crc32_u64_helper(crc_two, &s[(2 * block) + i]);
+  }
+
+  return hashmap_crc32_shift_helper(crc, shift_two) ^
+         hashmap_crc32_shift_helper(crc_one, shift_one) ^ crc_two;
+}
+#endif
+
+#if !defined(HASHMAP_64BIT)
+#if defined(HASHMAP_CRC32_STREAMS)
+HASHMAP_CRC32_INLINE hashmap_uint32_t
+hashmap_crc32_instructions_helper(hashmap_uint32_t crc,
+                                  const hashmap_uint8_t *const s,
+                                  const hashmap_size_t len) {
+  hashmap_size_t i = 0;
+
+  /* The shifts are x^(8n-33) mod P for n of 512, 256, 128 and 64 bytes. */
+  for (; (i + (3 * 256)) <= len; i += 3 * 256) {
+    crc = hashmap_crc32_streams_helper(crc, &s[i], 256, 0xb9e02b86u,
+                                       0xdd7e3b0cu);
+  }
+
+#if defined(HASHMAP_X86_PCLMUL)
+  /* Without a carry-less multiply instruction the shifts cost more than
+   * hashing blocks this short side by side saves. */
+  for (; (i + (3 * 64)) <= len; i += 3 * 64) {
+    crc = hashmap_crc32_streams_helper(crc, &s[i], 64, 0x9e4addf8u,
+                                       0x0d3b6092u);
+  }
+#endif
+
+  for (; (i + sizeof(hashmap_uint64_t)) <= len; i += sizeof(hashmap_uint64_t)) {
+    crc = hashmap_crc32_u64_helper(crc, &s[i]);
   }
 
+#if defined(HASHMAP_X86_CRC32_U64)
+  for (; i < len; i++) {
+    crc = _mm_crc32_u8(crc, s[i]);
+  }
+#else
   for (; i < len; i++) {
-    crc32val = __crc32b(crc32val, s[i]);
+    crc = __crc32cb(crc, s[i]);
   }
+#endif
+
+  return crc;
+}
+#endif
+
+#if defined(HASHMAP_CRC32_DISPATCH)
+HASHMAP_WEAK int hashmap_crc32_supported_helper(void) {
+#if defined(HASHMAP_ARM_CRC32_DISPATCH)
+  return 0 != (getauxval(AT_HWCAP) & HASHMAP_HWCAP_CRC32);
+#elif defined(_MSC_VER)
+  /* SSE 4.2 is bit 20 and PCLMULQDQ bit 1 of ecx. */
+  int info[4];
+  __cpuid(info, 1);
+  return (0 != (info[2] & (1 << 20))) && (0 != (info[2] & (1 << 1)));
 #else
+  return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("pclmul");
+#endif
+}
+#endif
+
+HASHMAP_ALWAYS_INLINE hashmap_uint32_t
+hashmap_crc32_table_helper(hashmap_uint32_t crc, const hashmap_uint8_t *const s,
+                           const hashmap_size_t len) {
   // Using polynomial 0x11EDC6F41 to match SSE 4.2's crc function.
   static const hashmap_uint32_t crc32_tab[] = {
       0x00000000U, 0xF26B8303U, 0xE13B70F7U, 0x1350F3F4U, 0xC79A971FU,
@@ -590,141 +4081,216 @@ hashmap_uint32_t hashmap_crc32_hasher(const hashmap_uint32_t seed,
       0xC69F7B69U, 0xD5CF889DU, 0x27A40B9EU, 0x79B737BAU, 0x8BDCB4B9U,
       0x988C474DU, 0x6AE7C44EU, 0xBE2DA0A5U, 0x4C4623A6U, 0x5F16D052U,
       0xAD7D5351U};
+  hashmap_size_t i;
 
-  for (; i < len; i++) {
-    crc32val = crc32_tab[(HASHMAP_CAST(hashmap_uint8_t, crc32val) ^ s[i])] ^
-               (crc32val >> 8);
+  for (i = 0; i < len; i++) {
+    crc = crc32_tab[(HASHMAP_CAST(hashmap_uint8_t, crc) ^ s[i])] ^ (crc >> 8);
   }
-#endif
-
-  // Use the mix function from murmur3.
-  crc32val ^= len;
-
-  crc32val ^= crc32val >> 16;
-  crc32val *= 0x85ebca6b;
-  crc32val ^= crc32val >> 13;
-  crc32val *= 0xc2b2ae35;
-  crc32val ^= crc32val >> 16;
 
-  return crc32val;
+  return crc;
 }
+#endif
 
-int hashmap_memcmp_comparer(const void *const a, const hashmap_uint32_t a_len,
-                            const void *const b, const hashmap_uint32_t b_len) {
-  return (a_len == b_len) && (0 == memcmp(a, b, a_len));
+HASHMAP_ALWAYS_INLINE hashmap_uint64_t
+hashmap_mul128_helper(const hashmap_uint64_t a, const hashmap_uint64_t b,
+                      hashmap_uint64_t *const out_high) {
+#if defined(__SIZEOF_INT128__) && !defined(__TINYC__)
+  __extension__ typedef unsigned __int128 hashmap_uint128_t;
+  const hashmap_uint128_t product = HASHMAP_CAST(hashmap_uint128_t, a) * b;
+  *out_high = HASHMAP_CAST(hashmap_uint64_t, product >> 64);
+  return HASHMAP_CAST(hashmap_uint64_t, product);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  return _umul128(a, b, out_high);
+#elif defined(_MSC_VER) && defined(_M_ARM64)
+  *out_high = __umulh(a, b);
+  return a * b;
+#else
+  /* Multiply the 32-bit halves and add up the four products. */
+  const hashmap_uint64_t a_low = a & 0xffffffffu, a_high = a >> 32;
+  const hashmap_uint64_t b_low = b & 0xffffffffu, b_high = b >> 32;
+  const hashmap_uint64_t low_low = a_low * b_low;
+  const hashmap_uint64_t low_high = a_low * b_high;
+  const hashmap_uint64_t high_low = a_high * b_low;
+  const hashmap_uint64_t middle =
+      (low_low >> 32) + (low_high & 0xffffffffu) + (high_low & 0xffffffffu);
+  *out_high = (a_high * b_high) + (low_high >> 32) + (high_low >> 32) +
+              (middle >> 32);
+  return (middle << 32) | (low_low & 0xffffffffu);
+#endif
 }
 
-HASHMAP_ALWAYS_INLINE hashmap_uint32_t
-hashmap_hash_helper_int_helper(const struct hashmap_s *const m,
-                               const void *const k, const hashmap_uint32_t l) {
-  return (m->hasher(~0u, k, l) * 2654435769u) >> (32u - m->log2_capacity);
+/* Multiply two 64-bit values and fold the 128-bit product back into 64. */
+HASHMAP_ALWAYS_INLINE hashmap_uint64_t
+hashmap_mum_helper(const hashmap_uint64_t a, const hashmap_uint64_t b) {
+  hashmap_uint64_t high;
+  const hashmap_uint64_t low = hashmap_mul128_helper(a, b, &high);
+  return low ^ high;
 }
 
-HASHMAP_ALWAYS_INLINE int
-hashmap_hash_helper(const struct hashmap_s *const m, const void *const key,
-                    const hashmap_uint32_t len,
-                    hashmap_uint32_t *const out_index) {
-  hashmap_uint32_t curr;
-  hashmap_uint32_t i;
-  hashmap_uint32_t first_free;
-
-  /* If full, return immediately */
-  if (hashmap_num_entries(m) == hashmap_capacity(m)) {
-    return 0;
-  }
-
-  /* Find the best index */
-  curr = hashmap_hash_helper_int_helper(m, key, len);
-  first_free = ~0u;
-
-  for (i = 0; i < HASHMAP_LINEAR_PROBE_LENGTH; i++) {
-    const hashmap_uint32_t index = curr + i;
-
-    if (!m->data[index].in_use) {
-      first_free = (first_free < index) ? first_free : index;
-    } else if (m->comparer(m->data[index].key, m->data[index].key_len, key,
-                           len)) {
-      *out_index = index;
-      return 1;
-    }
-  }
-
-  // Couldn't find a free element in the linear probe.
-  if (~0u == first_free) {
-    return 0;
-  }
-
-  *out_index = first_free;
-  return 1;
+HASHMAP_ALWAYS_INLINE hashmap_uint64_t
+hashmap_read64_helper(const hashmap_uint8_t *const s) {
+  hashmap_uint64_t result;
+  memcpy(&result, s, sizeof(result));
+  return result;
 }
 
-int hashmap_rehash_iterator(void *const new_hash,
-                            struct hashmap_element_s *const e) {
-  int temp = hashmap_put(HASHMAP_PTR_CAST(struct hashmap_s *, new_hash), e->key,
-                         e->key_len, e->data);
-
-  if (0 < temp) {
-    return 1;
-  }
+HASHMAP_ALWAYS_INLINE hashmap_uint64_t
+hashmap_read32_helper(const hashmap_uint8_t *const s) {
+  hashmap_uint32_t result;
+  memcpy(&result, s, sizeof(result));
+  return result;
+}
 
-  /* clear old value to avoid stale pointers */
-  return -1;
+HASHMAP_ALWAYS_INLINE hashmap_hash_t
+hashmap_fold_hash_helper(const hashmap_uint64_t hash) {
+#if defined(HASHMAP_64BIT)
+  return hash;
+#else
+  return HASHMAP_CAST(hashmap_hash_t, hash ^ (hash >> 32));
+#endif
 }
 
 /*
- * Doubles the size of the hashmap, and rehashes all the elements
+ * Mixes one vector of key bytes into the lanes it holds. Each lane adds the
+ * product of the two halves of its 8 bytes (xored with the secret), plus the
+ * raw 8 bytes of its neighbour, so that no byte of the key can be multiplied
+ * away by zero.
  */
-HASHMAP_ALWAYS_INLINE int hashmap_rehash_helper(struct hashmap_s *const m) {
-  struct hashmap_create_options_s options;
-  struct hashmap_s new_m;
-  int flag;
+#if defined(HASHMAP_X86_AVX2)
+HASHMAP_ALWAYS_INLINE __m256i hashmap_stripe_lanes_helper(
+    const __m256i lanes, const hashmap_uint8_t *const s, const __m256i secret) {
+  const __m256i data = _mm256_loadu_si256(
+      HASHMAP_PTR_CAST(const __m256i *, HASHMAP_PTR_CAST(const void *, s)));
+  const __m256i keyed = _mm256_xor_si256(data, secret);
+  const __m256i product =
+      _mm256_mul_epu32(keyed, _mm256_shuffle_epi32(keyed, 0x31));
+  return _mm256_add_epi64(
+      lanes, _mm256_add_epi64(product, _mm256_shuffle_epi32(data, 0x4e)));
+}
+#elif defined(HASHMAP_X86_SSE2)
+HASHMAP_ALWAYS_INLINE __m128i hashmap_stripe_lanes_helper(
+    const __m128i lanes, const hashmap_uint8_t *const s, const __m128i secret) {
+  const __m128i data = _mm_loadu_si128(
+      HASHMAP_PTR_CAST(const __m128i *, HASHMAP_PTR_CAST(const void *, s)));
+  const __m128i keyed = _mm_xor_si128(data, secret);
+  /* Multiply the low half of each 8 bytes by its high half, and swap the two
+   * 8 bytes to add each to its neighbour's lane. */
+  const __m128i product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, 0x31));
+  return _mm_add_epi64(lanes,
+                       _mm_add_epi64(product, _mm_shuffle_epi32(data, 0x4e)));
+}
+#elif defined(HASHMAP_ARM_NEON)
+HASHMAP_ALWAYS_INLINE uint64x2_t
+hashmap_stripe_lanes_helper(const uint64x2_t lanes,
+                            const hashmap_uint8_t *const s,
+                            const uint64x2_t secret) {
+  const uint64x2_t data = vreinterpretq_u64_u8(vld1q_u8(s));
+  const uint64x2_t keyed = veorq_u64(data, secret);
+  const uint64x2_t product =
+      vmull_u32(vmovn_u64(keyed), vshrn_n_u64(keyed, 32));
+  return vaddq_u64(lanes, vaddq_u64(product, vextq_u64(data, data, 1)));
+}
+#endif
 
-  memset(&options, 0, sizeof(options));
-  options.initial_capacity = hashmap_capacity(m) * 2;
-  options.hasher = m->hasher;
-  options.comparer = m->comparer;
+/*
+ * Mixes a run of 64 byte stripes into the 8 lanes of acc, keeping the lanes in
+ * vector registers across the whole run when the target has them.
+ */
+HASHMAP_ALWAYS_INLINE void
+hashmap_stripes_helper(hashmap_uint64_t *const acc,
+                       const hashmap_uint8_t *const s,
+                       const hashmap_uint64_t *const secret,
+                       const hashmap_size_t stripes) {
+  hashmap_size_t i;
+#if defined(HASHMAP_X86_AVX2)
+  /* Each of these holds four lanes. */
+  __m256i *const acc_vec = HASHMAP_PTR_CAST(__m256i *,
+                                            HASHMAP_PTR_CAST(void *, acc));
+  const __m256i *const secret_vec = HASHMAP_PTR_CAST(
+      const __m256i *, HASHMAP_PTR_CAST(const void *, secret));
+  const __m256i secret0 = _mm256_loadu_si256(&secret_vec[0]);
+  const __m256i secret1 = _mm256_loadu_si256(&secret_vec[1]);
+  __m256i lanes0 = _mm256_loadu_si256(&acc_vec[0]);
+  __m256i lanes1 = _mm256_loadu_si256(&acc_vec[1]);
 
-  if (0 == options.initial_capacity) {
-    return 1;
+  for (i = 0; i < stripes; i++) {
+    lanes0 = hashmap_stripe_lanes_helper(lanes0, &s[(i * 64) + 0], secret0);
+    lanes1 = hashmap_stripe_lanes_helper(lanes1, &s[(i * 64) + 32], secret1);
   }
 
-  flag = hashmap_create_ex(options, &new_m);
+  _mm256_storeu_si256(&acc_vec[0], lanes0);
+  _mm256_storeu_si256(&acc_vec[1], lanes1);
+#elif defined(HASHMAP_X86_SSE2)
+  /* Each of these holds two lanes. */
+  __m128i *const acc_vec = HASHMAP_PTR_CAST(__m128i *,
+                                            HASHMAP_PTR_CAST(void *, acc));
+  const __m128i *const secret_vec = HASHMAP_PTR_CAST(
+      const __m128i *, HASHMAP_PTR_CAST(const void *, secret));
+  const __m128i secret0 = _mm_loadu_si128(&secret_vec[0]);
+  const __m128i secret1 = _mm_loadu_si128(&secret_vec[1]);
+  const __m128i secret2 = _mm_loadu_si128(&secret_vec[2]);
+  const __m128i secret3 = _mm_loadu_si128(&secret_vec[3]);
+  __m128i lanes0 = _mm_loadu_si128(&acc_vec[0]);
+  __m128i lanes1 = _mm_loadu_si128(&acc_vec[1]);
+  __m128i lanes2 = _mm_loadu_si128(&acc_vec[2]);
+  __m128i lanes3 = _mm_loadu_si128(&acc_vec[3]);
 
-  if (0 != flag) {
-    return flag;
+  for (i = 0; i < stripes; i++) {
+    lanes0 = hashmap_stripe_lanes_helper(lanes0, &s[(i * 64) + 0], secret0);
+    lanes1 = hashmap_stripe_lanes_helper(lanes1, &s[(i * 64) + 16], secret1);
+    lanes2 = hashmap_stripe_lanes_helper(lanes2, &s[(i * 64) + 32], secret2);
+    lanes3 = hashmap_stripe_lanes_helper(lanes3, &s[(i * 64) + 48], secret3);
   }
 
-  /* copy the old elements to the new table */
-  flag = hashmap_iterate_pairs(m, hashmap_rehash_iterator,
-                               HASHMAP_PTR_CAST(void *, &new_m));
+  _mm_storeu_si128(&acc_vec[0], lanes0);
+  _mm_storeu_si128(&acc_vec[1], lanes1);
+  _mm_storeu_si128(&acc_vec[2], lanes2);
+  _mm_storeu_si128(&acc_vec[3], lanes3);
+#elif defined(HASHMAP_ARM_NEON)
+  const uint64x2_t secret0 = vld1q_u64(&secret[0]);
+  const uint64x2_t secret1 = vld1q_u64(&secret[2]);
+  const uint64x2_t secret2 = vld1q_u64(&secret[4]);
+  const uint64x2_t secret3 = vld1q_u64(&secret[6]);
+  uint64x2_t lanes0 = vld1q_u64(&acc[0]);
+  uint64x2_t lanes1 = vld1q_u64(&acc[2]);
+  uint64x2_t lanes2 = vld1q_u64(&acc[4]);
+  uint64x2_t lanes3 = vld1q_u64(&acc[6]);
 
-  if (0 != flag) {
-    return flag;
+  for (i = 0; i < stripes; i++) {
+    lanes0 = hashmap_stripe_lanes_helper(lanes0, &s[(i * 64) + 0], secret0);
+    lanes1 = hashmap_stripe_lanes_helper(lanes1, &s[(i * 64) + 16], secret1);
+    lanes2 = hashmap_stripe_lanes_helper(lanes2, &s[(i * 64) + 32], secret2);
+    lanes3 = hashmap_stripe_lanes_helper(lanes3, &s[(i * 64) + 48], secret3);
   }
 
-  hashmap_destroy(m);
-
-  /* put new hash into old hash structure by copying */
-  memcpy(m, &new_m, sizeof(struct hashmap_s));
+  vst1q_u64(&acc[0], lanes0);
+  vst1q_u64(&acc[2], lanes1);
+  vst1q_u64(&acc[4], lanes2);
+  vst1q_u64(&acc[6], lanes3);
+#else
+  hashmap_size_t j;
 
-  return 0;
+  for (i = 0; i < stripes; i++) {
+    for (j = 0; j < 8; j++) {
+      const hashmap_uint64_t data = hashmap_read64_helper(&s[(i * 64) + (j * 8)]);
+      const hashmap_uint64_t keyed = data ^ secret[j];
+      acc[j ^ 1] += data;
+      acc[j] += (keyed & 0xffffffffu) * (keyed >> 32);
+    }
+  }
+#endif
 }
 
-HASHMAP_ALWAYS_INLINE hashmap_uint32_t hashmap_clz(const hashmap_uint32_t x) {
-#if defined(_MSC_VER)
-  unsigned long result;
-  _BitScanReverse(&result, x);
-  return 31u - HASHMAP_CAST(hashmap_uint32_t, result);
-#elif defined(__TINYC__)
-  union {
-    double d;
-    hashmap_uint64_t u;
-  } u;
-  u.d = HASHMAP_CAST(double, x) + 0.5;
-  return 1054u - HASHMAP_CAST(hashmap_uint32_t, u.u >> 52);
-#else
-  return HASHMAP_CAST(hashmap_uint32_t, __builtin_clz(x));
-#endif
+/* Stir the top bits of each lane back into the bottom ones, so that no lane
+ * grows too big for its upper bits to depend on the key. */
+HASHMAP_ALWAYS_INLINE void
+hashmap_scramble_helper(hashmap_uint64_t *const acc,
+                        const hashmap_uint64_t *const secret) {
+  hashmap_size_t j;
+
+  for (j = 0; j < 8; j++) {
+    acc[j] = (acc[j] ^ (acc[j] >> 47) ^ secret[j]) * 0x9e3779b1u;
+  }
 }
 
 #if defined(_MSC_VER)
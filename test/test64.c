@@ -0,0 +1,41 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+
+// The 64-bit build changes the layout of the hashmap, so it has to be built
+// into its own executable rather than alongside the other tests. So do
+// HASHMAP_DEBUG, HASHMAP_SMALL_SIZE and HASHMAP_INLINE_KEY_SIZE, so they are
+// tested here with 64-bit sizes too, as well as on their own in
+// test_options.c.
+#define HASHMAP_64BIT
+#define HASHMAP_DEBUG
+#define HASHMAP_SMALL_SIZE 8
+#define HASHMAP_INLINE_KEY_SIZE 16
+
+#include "hashmap.h"
+#include "utest.h"
+
+#define MY_TEST_WRAPPER(name) UTEST(c64, name)
+
+#include "test.inc"
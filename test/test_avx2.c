@@ -0,0 +1,10 @@
+#include "hashmap.h"
+#include "utest.h"
+
+#if defined(__AVX2__)
+
+#define MY_TEST_WRAPPER(name) UTEST(c_avx2, name)
+
+#include "test.inc"
+
+#endif
@@ -0,0 +1,12 @@
+#include "hashmap.h"
+#include "utest.h"
+
+// Without PCLMUL the crc32 hasher shifts its streams with a table instead,
+// which is otherwise only built on AArch64.
+#if !defined(_MSC_VER) && defined(__SSE4_2__) && !defined(__PCLMUL__)
+
+#define MY_TEST_WRAPPER(name) UTEST(c_sse42_no_pclmul, name)
+
+#include "test.inc"
+
+#endif